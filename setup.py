@@ -1,9 +1,29 @@
 #!/usr/bin/python
 
+import os
+
 from distutils.core import setup
 from distutils.extension import Extension
 
-sources = ['src/module.cpp'] 
+sources = ['src/module.cpp',
+           'src/allocation_stats.cpp',
+           'src/array_range.cpp',
+           'src/history_aggregates.cpp',
+           'src/history_log.cpp',
+           'src/lazy_address_space.cpp',
+           'src/memory_stats.cpp',
+           'src/node_id_text.cpp',
+           'src/node_registry.cpp',
+           'src/reconnecting_server.cpp',
+           'src/request_pipeline.cpp',
+           'src/sampling_engine.cpp',
+           'src/shared_value_table.cpp',
+           'src/subtree_template.cpp',
+           'src/timer_wheel.cpp',
+           'src/update_queue.cpp',
+           'src/write_buffer.cpp',
+           'src/write_hook.cpp'
+          ]
 
 includes = [
             '../client/include',
@@ -13,11 +33,20 @@ includes = [
 cpp_flags = ['-std=c++11', 
              '-DMODULE_NAME=opcua']
 
+# Counts heap allocations for tests/bench_allocations.py.
+if os.environ.get('OPCUA_COUNT_ALLOCATIONS'):
+    cpp_flags.append('-DOPCUA_COUNT_ALLOCATIONS')
+
+# Portable history aggregates, for comparison in tests/bench_aggregates.py.
+if os.environ.get('OPCUA_SCALAR_AGGREGATES'):
+    cpp_flags.append('-DOPCUA_SCALAR_AGGREGATES')
+
 libs = ['opccore',
         'opcuabinary',
         'opcua_client',
         'stdc++',
         'pthread',
+        'rt',
         'boost_python']
 
 ldirs = [
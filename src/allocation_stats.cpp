@@ -0,0 +1,77 @@
+/// @brief Process wide count of heap allocations for benchmarks.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "allocation_stats.h"
+
+#ifdef OPCUA_COUNT_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+  std::atomic<uint64_t> Allocations(0);
+  std::atomic<uint64_t> AllocatedBytes(0);
+}
+
+void* operator new(std::size_t size)
+{
+  Allocations.fetch_add(1, std::memory_order_relaxed);
+  AllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* memory = std::malloc(size ? size : 1))
+  {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+  std::free(memory);
+}
+
+namespace OpcUa
+{
+
+  bool IsAllocationCountingEnabled()
+  {
+    return true;
+  }
+
+  AllocationStats GetAllocationStats()
+  {
+    AllocationStats stats;
+    stats.Allocations = Allocations.load(std::memory_order_relaxed);
+    stats.Bytes = AllocatedBytes.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+}
+
+#else
+
+namespace OpcUa
+{
+
+  bool IsAllocationCountingEnabled()
+  {
+    return false;
+  }
+
+  AllocationStats GetAllocationStats()
+  {
+    AllocationStats stats;
+    stats.Allocations = 0;
+    stats.Bytes = 0;
+    return stats;
+  }
+
+}
+
+#endif
@@ -0,0 +1,26 @@
+/// @brief Process wide count of heap allocations for benchmarks.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <cstdint>
+
+namespace OpcUa
+{
+
+  struct AllocationStats
+  {
+    uint64_t Allocations;
+    uint64_t Bytes;
+  };
+
+  // Counting replaces the global operator new and is compiled in only with OPCUA_COUNT_ALLOCATIONS.
+  bool IsAllocationCountingEnabled();
+  AllocationStats GetAllocationStats();
+
+}
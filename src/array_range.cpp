@@ -0,0 +1,355 @@
+/// @brief Index ranges of array values.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "array_range.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+  using namespace OpcUa;
+
+  bool ParseIndex(const std::string& text, std::size_t& pos, uint32_t& result)
+  {
+    const std::size_t start = pos;
+    uint64_t value = 0;
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+    {
+      value = value * 10 + (text[pos] - '0');
+      if (value > std::numeric_limits<uint32_t>::max())
+      {
+        return false;
+      }
+      ++pos;
+    }
+    result = static_cast<uint32_t>(value);
+    return pos > start;
+  }
+
+  // Shape of the selected block inside a row-major array.
+  struct RangeGeometry
+  {
+    std::vector<std::size_t> Strides;
+    std::vector<std::size_t> Counts;
+    ArrayRange Range;
+    std::size_t Count;
+  };
+
+  bool GetGeometry(const Variant& value, std::size_t size, const ArrayRange& range, bool cutOff, RangeGeometry& geometry)
+  {
+    const std::vector<std::size_t> dims = GetDimensions(value);
+    if (range.size() != dims.size())
+    {
+      return false;
+    }
+    std::size_t total = 1;
+    for (std::size_t dim : dims)
+    {
+      total *= dim;
+    }
+    if (total != size)
+    {
+      return false;
+    }
+
+    geometry.Range = range;
+    geometry.Strides.assign(dims.size(), 1);
+    geometry.Counts.resize(dims.size());
+    geometry.Count = 1;
+    for (std::size_t d = dims.size(); d-- > 0;)
+    {
+      ArrayRangeDimension& dimension = geometry.Range[d];
+      if (dimension.First >= dims[d] || (!cutOff && dimension.Last >= dims[d]))
+      {
+        return false;
+      }
+      dimension.Last = std::min<std::size_t>(dimension.Last, dims[d] - 1);
+      geometry.Counts[d] = dimension.Last - dimension.First + 1;
+      geometry.Count *= geometry.Counts[d];
+      if (d + 1 < dims.size())
+      {
+        geometry.Strides[d] = geometry.Strides[d + 1] * dims[d + 1];
+      }
+    }
+    return true;
+  }
+
+  // Calls function(offset, count) for every contiguous run of the block, in order.
+  template <typename Function>
+  void ForEachRun(const RangeGeometry& geometry, Function function)
+  {
+    const std::size_t last = geometry.Range.size() - 1;
+    std::vector<uint32_t> index(geometry.Range.size());
+    for (std::size_t d = 0; d < index.size(); ++d)
+    {
+      index[d] = geometry.Range[d].First;
+    }
+    for (;;)
+    {
+      std::size_t offset = 0;
+      for (std::size_t d = 0; d < index.size(); ++d)
+      {
+        offset += index[d] * geometry.Strides[d];
+      }
+      function(offset, geometry.Counts[last]);
+
+      std::size_t d = last;
+      while (d > 0 && index[d - 1] == geometry.Range[d - 1].Last)
+      {
+        index[d - 1] = geometry.Range[d - 1].First;
+        --d;
+      }
+      if (d == 0)
+      {
+        return;
+      }
+      ++index[d - 1];
+    }
+  }
+
+  // Calls operation with the member of VariantValue that holds values of the type.
+  template <typename Operation>
+  bool ForValues(VariantType type, Operation& operation)
+  {
+    switch (type)
+    {
+      case VariantType::BOOLEAN: operation(&VariantValue::Boolean); return true;
+      case VariantType::SBYTE: operation(&VariantValue::SByte); return true;
+      case VariantType::BYTE: operation(&VariantValue::Byte); return true;
+      case VariantType::INT16: operation(&VariantValue::Int16); return true;
+      case VariantType::UINT16: operation(&VariantValue::UInt16); return true;
+      case VariantType::INT32: operation(&VariantValue::Int32); return true;
+      case VariantType::UINT32: operation(&VariantValue::UInt32); return true;
+      case VariantType::INT64: operation(&VariantValue::Int64); return true;
+      case VariantType::UINT64: operation(&VariantValue::UInt64); return true;
+      case VariantType::FLOAT: operation(&VariantValue::Float); return true;
+      case VariantType::DOUBLE: operation(&VariantValue::Double); return true;
+      case VariantType::STATUS_CODE: operation(&VariantValue::Statuses); return true;
+      case VariantType::STRING: operation(&VariantValue::String); return true;
+      case VariantType::DATE_TIME: operation(&VariantValue::Time); return true;
+      case VariantType::GUID: operation(&VariantValue::Guids); return true;
+      case VariantType::BYTE_STRING: operation(&VariantValue::ByteStrings); return true;
+      case VariantType::NODE_ID: operation(&VariantValue::Node); return true;
+      case VariantType::QUALIFIED_NAME: operation(&VariantValue::Name); return true;
+      case VariantType::LOCALIZED_TEXT: operation(&VariantValue::Text); return true;
+      default: return false;
+    }
+  }
+
+  struct SizeOperation
+  {
+    const Variant& Value;
+    std::size_t Size;
+
+    template <typename T>
+    void operator()(std::vector<T> VariantValue::* member)
+    {
+      Size = (Value.Value.*member).size();
+    }
+  };
+
+  struct ExtractOperation
+  {
+    const Variant& Value;
+    const RangeGeometry& Geometry;
+    Variant& Result;
+
+    template <typename T>
+    void operator()(std::vector<T> VariantValue::* member)
+    {
+      const std::vector<T>& from = Value.Value.*member;
+      std::vector<T>& to = Result.Value.*member;
+      to.clear();
+      to.reserve(Geometry.Count);
+      ForEachRun(Geometry, [&from, &to](std::size_t offset, std::size_t count)
+      {
+        to.insert(to.end(), from.begin() + offset, from.begin() + offset + count);
+      });
+    }
+  };
+
+  struct ReplaceOperation
+  {
+    const Variant& Slice;
+    const RangeGeometry& Geometry;
+    Variant& Value;
+
+    template <typename T>
+    void operator()(std::vector<T> VariantValue::* member)
+    {
+      const std::vector<T>& from = Slice.Value.*member;
+      std::vector<T>& to = Value.Value.*member;
+      std::size_t position = 0;
+      ForEachRun(Geometry, [&from, &to, &position](std::size_t offset, std::size_t count)
+      {
+        std::copy(from.begin() + position, from.begin() + position + count, to.begin() + offset);
+        position += count;
+      });
+    }
+  };
+
+  struct SplitOperation
+  {
+    const Variant& Value;
+    std::vector<Variant>& Elements;
+
+    template <typename T>
+    void operator()(std::vector<T> VariantValue::* member)
+    {
+      const std::vector<T>& from = Value.Value.*member;
+      Elements.resize(from.size());
+      for (std::size_t i = 0; i < from.size(); ++i)
+      {
+        Elements[i].Type = Value.Type;
+        (Elements[i].Value.*member).assign(1, from[i]);
+      }
+    }
+  };
+}
+
+namespace OpcUa
+{
+
+  ArrayRange ParseArrayRange(const std::string& text)
+  {
+    ArrayRange range;
+    std::size_t pos = 0;
+    for (;;)
+    {
+      ArrayRangeDimension dimension;
+      if (!ParseIndex(text, pos, dimension.First))
+      {
+        throw std::logic_error("Invalid index range '" + text + "'.");
+      }
+      dimension.Last = dimension.First;
+      if (pos < text.size() && text[pos] == ':')
+      {
+        ++pos;
+        if (!ParseIndex(text, pos, dimension.Last) || dimension.Last <= dimension.First)
+        {
+          throw std::logic_error("Invalid index range '" + text + "'.");
+        }
+      }
+      range.push_back(dimension);
+      if (pos == text.size())
+      {
+        return range;
+      }
+      if (text[pos] != ',')
+      {
+        throw std::logic_error("Invalid index range '" + text + "'.");
+      }
+      ++pos;
+    }
+  }
+
+  std::size_t GetElementCount(const Variant& value)
+  {
+    SizeOperation operation = {value, 0};
+    ForValues(value.Type, operation);
+    return operation.Size;
+  }
+
+  std::size_t GetElementCount(const ArrayRange& range)
+  {
+    std::size_t count = 1;
+    for (const ArrayRangeDimension& dimension : range)
+    {
+      count *= dimension.Last - dimension.First + 1;
+    }
+    return count;
+  }
+
+  std::vector<std::size_t> GetDimensions(const Variant& value)
+  {
+    std::vector<std::size_t> dims(value.Dimensions.begin(), value.Dimensions.end());
+    if (dims.empty())
+    {
+      dims.push_back(GetElementCount(value));
+    }
+    return dims;
+  }
+
+  std::vector<std::size_t> GetArrayDimensions(const Variant& attribute)
+  {
+    if (attribute.Type != VariantType::UINT32)
+    {
+      return std::vector<std::size_t>();
+    }
+    const std::vector<uint32_t>& dims = attribute.Value.UInt32;
+    // 0 stands for an unknown length.
+    if (std::find(dims.begin(), dims.end(), 0) != dims.end())
+    {
+      return std::vector<std::size_t>();
+    }
+    return std::vector<std::size_t>(dims.begin(), dims.end());
+  }
+
+  bool GetRangeShape(const std::vector<std::size_t>& dimensions, const ArrayRange& range, std::vector<std::size_t>& shape)
+  {
+    if (dimensions.size() != range.size())
+    {
+      return false;
+    }
+    shape.resize(dimensions.size());
+    for (std::size_t d = 0; d < dimensions.size(); ++d)
+    {
+      if (range[d].First >= dimensions[d])
+      {
+        return false;
+      }
+      shape[d] = std::min<std::size_t>(range[d].Last, dimensions[d] - 1) - range[d].First + 1;
+    }
+    return true;
+  }
+
+  bool ExtractRange(const Variant& value, const ArrayRange& range, Variant& result)
+  {
+    RangeGeometry geometry;
+    if (!GetGeometry(value, GetElementCount(value), range, true, geometry))
+    {
+      return false;
+    }
+    ExtractOperation operation = {value, geometry, result};
+    if (!ForValues(value.Type, operation))
+    {
+      return false;
+    }
+    result.Type = value.Type;
+    result.Dimensions.clear();
+    if (geometry.Counts.size() > 1)
+    {
+      result.Dimensions.assign(geometry.Counts.begin(), geometry.Counts.end());
+    }
+    return true;
+  }
+
+  bool ReplaceRange(Variant& value, const ArrayRange& range, const Variant& slice)
+  {
+    RangeGeometry geometry;
+    if (slice.Type != value.Type || !GetGeometry(value, GetElementCount(value), range, false, geometry))
+    {
+      return false;
+    }
+    if (GetElementCount(slice) != geometry.Count)
+    {
+      return false;
+    }
+    ReplaceOperation operation = {slice, geometry, value};
+    return ForValues(value.Type, operation);
+  }
+
+  bool SplitElements(const Variant& value, std::vector<Variant>& elements)
+  {
+    SplitOperation operation = {value, elements};
+    return ForValues(value.Type, operation);
+  }
+
+}
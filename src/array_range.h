@@ -0,0 +1,52 @@
+/// @brief Index ranges of array values.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <opc/ua/protocol/types.h>
+
+#include <string>
+#include <vector>
+
+namespace OpcUa
+{
+
+  struct ArrayRangeDimension
+  {
+    uint32_t First;
+    uint32_t Last; // Inclusive.
+  };
+
+  // One entry per array dimension, as in "1:2,0:3".
+  typedef std::vector<ArrayRangeDimension> ArrayRange;
+
+  // Throws std::logic_error when the text is not a valid index range.
+  ArrayRange ParseArrayRange(const std::string& text);
+
+  // Number of array elements of the value, 1 for a scalar and 0 for an empty variant.
+  std::size_t GetElementCount(const Variant& value);
+  // Number of elements the range selects when nothing is cut off at the end of the array.
+  std::size_t GetElementCount(const ArrayRange& range);
+
+  // Dimensions of an array value, a single one unless the value has Dimensions set.
+  std::vector<std::size_t> GetDimensions(const Variant& value);
+  // Dimensions from the ArrayDimensions attribute, empty when the server does not know them.
+  std::vector<std::size_t> GetArrayDimensions(const Variant& attribute);
+  // Shape the range selects from an array of the given dimensions, cut off at the end of the array.
+  // Returns false when the range has no data in the array or does not match its dimensions.
+  bool GetRangeShape(const std::vector<std::size_t>& dimensions, const ArrayRange& range, std::vector<std::size_t>& shape);
+
+  // Copy the selected elements into result. Ranges running past the end of the array are cut off.
+  // Returns false when the range has no data in the value or does not match its dimensions.
+  bool ExtractRange(const Variant& value, const ArrayRange& range, Variant& result);
+  // Overwrite the selected elements with the ones of slice, which must have the same type and size.
+  bool ReplaceRange(Variant& value, const ArrayRange& range, const Variant& slice);
+  // One scalar variant per array element. Returns false for types without element access.
+  bool SplitElements(const Variant& value, std::vector<Variant>& elements);
+
+}
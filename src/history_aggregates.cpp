@@ -0,0 +1,268 @@
+/// @brief Aggregates of stored history computed per processing interval.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "history_aggregates.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__SSE2__) && !defined(OPCUA_SCALAR_AGGREGATES)
+#define OPCUA_SSE2_AGGREGATES
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+  using namespace OpcUa;
+
+  const uint32_t StatusSeverityMask = 0xC0000000;
+  const uint32_t StatusBadNoData = 0x809B0000;
+  // More intervals than this is a mistake of the caller rather than a query.
+  const int64_t MaxIntervals = 1 << 24;
+
+  bool IsGood(const HistoryRecord& record)
+  {
+    return (record.Status & StatusSeverityMask) == 0;
+  }
+
+  RangeSummary EmptySummary()
+  {
+    RangeSummary summary;
+    summary.Count = 0;
+    summary.Minimum = std::numeric_limits<double>::infinity();
+    summary.Maximum = -std::numeric_limits<double>::infinity();
+    summary.Sum = 0;
+    return summary;
+  }
+
+  void Merge(RangeSummary& to, const RangeSummary& from)
+  {
+    to.Count += from.Count;
+    to.Minimum = to.Minimum < from.Minimum ? to.Minimum : from.Minimum;
+    to.Maximum = to.Maximum > from.Maximum ? to.Maximum : from.Maximum;
+    to.Sum += from.Sum;
+  }
+
+#ifdef OPCUA_SSE2_AGGREGATES
+  // Records are 24 bytes, so values are gathered in pairs with two loads each.
+  // Statuses are collected in the same pass; the result is valid only when all of them are good.
+  RangeSummary SummarizeSSE2(const HistoryRecord* begin, const HistoryRecord* end, uint32_t& statuses)
+  {
+    __m128d min0 = _mm_set1_pd(std::numeric_limits<double>::infinity());
+    __m128d max0 = _mm_set1_pd(-std::numeric_limits<double>::infinity());
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d min1 = min0;
+    __m128d max1 = max0;
+    __m128d sum1 = sum0;
+    uint32_t collected = 0;
+    const HistoryRecord* record = begin;
+    for (; end - record >= 4; record += 4)
+    {
+      collected |= record[0].Status | record[1].Status | record[2].Status | record[3].Status;
+      const __m128d first = _mm_loadh_pd(_mm_load_sd(&record[0].Value), &record[1].Value);
+      const __m128d second = _mm_loadh_pd(_mm_load_sd(&record[2].Value), &record[3].Value);
+      min0 = _mm_min_pd(min0, first);
+      max0 = _mm_max_pd(max0, first);
+      sum0 = _mm_add_pd(sum0, first);
+      min1 = _mm_min_pd(min1, second);
+      max1 = _mm_max_pd(max1, second);
+      sum1 = _mm_add_pd(sum1, second);
+    }
+    double mins[2];
+    double maxs[2];
+    double sums[2];
+    _mm_storeu_pd(mins, _mm_min_pd(min0, min1));
+    _mm_storeu_pd(maxs, _mm_max_pd(max0, max1));
+    _mm_storeu_pd(sums, _mm_add_pd(sum0, sum1));
+
+    RangeSummary summary;
+    summary.Count = record - begin;
+    summary.Minimum = mins[0] < mins[1] ? mins[0] : mins[1];
+    summary.Maximum = maxs[0] > maxs[1] ? maxs[0] : maxs[1];
+    summary.Sum = sums[0] + sums[1];
+    for (const HistoryRecord* tail = record; tail != end; ++tail)
+    {
+      collected |= tail->Status;
+    }
+    Merge(summary, SummarizeScalar(record, end));
+    statuses = collected;
+    return summary;
+  }
+#endif
+
+  struct IntervalState
+  {
+    RangeSummary Summary;
+    // Copies: the scanned records are valid only inside the scan callback.
+    HistoryRecord First; // First and last good sample.
+    HistoryRecord Last;
+    bool HasGood;
+  };
+
+  double Interpolate(const HistoryRecord& before, const HistoryRecord& after, int64_t time)
+  {
+    if (after.Timestamp == before.Timestamp)
+    {
+      return after.Value;
+    }
+    const double position = static_cast<double>(time - before.Timestamp) / (after.Timestamp - before.Timestamp);
+    return before.Value + (after.Value - before.Value) * position;
+  }
+}
+
+namespace OpcUa
+{
+
+  const char* GetAggregateKernel()
+  {
+#ifdef OPCUA_SSE2_AGGREGATES
+    return "sse2";
+#else
+    return "scalar";
+#endif
+  }
+
+  RangeSummary SummarizeScalar(const HistoryRecord* begin, const HistoryRecord* end)
+  {
+    RangeSummary summary = EmptySummary();
+    for (const HistoryRecord* record = begin; record != end; ++record)
+    {
+      if (!IsGood(*record))
+      {
+        continue;
+      }
+      const double value = record->Value;
+      ++summary.Count;
+      summary.Minimum = summary.Minimum < value ? summary.Minimum : value;
+      summary.Maximum = summary.Maximum > value ? summary.Maximum : value;
+      summary.Sum += value;
+    }
+    return summary;
+  }
+
+  RangeSummary Summarize(const HistoryRecord* begin, const HistoryRecord* end)
+  {
+#ifdef OPCUA_SSE2_AGGREGATES
+    // Stored samples are nearly always good, ranges with a bad one are summarized again.
+    uint32_t statuses = 0;
+    const RangeSummary summary = SummarizeSSE2(begin, end, statuses);
+    if (!(statuses & StatusSeverityMask))
+    {
+      return summary;
+    }
+#endif
+    return SummarizeScalar(begin, end);
+  }
+
+  std::vector<HistoryRecord> ReadProcessed(const HistoryLog& log, const std::string& series, int64_t start, int64_t end, int64_t interval, AggregateType type)
+  {
+    if (interval <= 0 || end <= start)
+    {
+      throw std::logic_error("Processed history needs a non empty time range and a positive interval.");
+    }
+    if ((end - start - 1) / interval >= MaxIntervals)
+    {
+      throw std::logic_error("Too many processing intervals.");
+    }
+    const std::size_t count = (end - start - 1) / interval + 1;
+
+    IntervalState empty;
+    empty.Summary = EmptySummary();
+    empty.HasGood = false;
+    std::vector<IntervalState> intervals(count, empty);
+    log.Scan(series, start, end, [&intervals, start, interval](const HistoryRecord* begin, const HistoryRecord* last)
+      {
+        const HistoryRecord* record = begin;
+        while (record != last)
+        {
+          const std::size_t index = (record->Timestamp - start) / interval;
+          const int64_t intervalEnd = start + static_cast<int64_t>(index + 1) * interval;
+          const HistoryRecord* next = std::lower_bound(record, last, intervalEnd, [](const HistoryRecord& r, int64_t time) { return r.Timestamp < time; });
+          IntervalState& state = intervals[index];
+          Merge(state.Summary, Summarize(record, next));
+
+          const HistoryRecord* firstGood = std::find_if(record, next, IsGood);
+          if (firstGood != next)
+          {
+            const HistoryRecord* lastGood = next;
+            while (!IsGood(*--lastGood))
+            {
+            }
+            if (!state.HasGood)
+            {
+              state.First = *firstGood;
+              state.HasGood = true;
+            }
+            state.Last = *lastGood;
+          }
+          record = next;
+        }
+      });
+
+    std::vector<HistoryRecord> result(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      const RangeSummary& summary = intervals[i].Summary;
+      HistoryRecord& record = result[i];
+      record.Timestamp = start + static_cast<int64_t>(i) * interval;
+      record.Status = summary.Count ? 0 : StatusBadNoData;
+      switch (type)
+      {
+        case AggregateType::Count:
+          record.Value = summary.Count;
+          record.Status = 0;
+          break;
+        case AggregateType::Minimum:
+          record.Value = summary.Count ? summary.Minimum : 0;
+          break;
+        case AggregateType::Maximum:
+          record.Value = summary.Count ? summary.Maximum : 0;
+          break;
+        case AggregateType::Average:
+          record.Value = summary.Count ? summary.Sum / summary.Count : 0;
+          break;
+        case AggregateType::Interpolative:
+          record.Status = StatusBadNoData;
+          break;
+        default:
+          throw std::logic_error("Unknown aggregate.");
+      }
+    }
+
+    if (type == AggregateType::Interpolative)
+    {
+      // The good sample at or after each interval start, found from the back.
+      std::vector<const HistoryRecord*> after(count, nullptr);
+      const HistoryRecord* next = nullptr;
+      for (std::size_t i = count; i-- > 0;)
+      {
+        next = intervals[i].HasGood ? &intervals[i].First : next;
+        after[i] = next;
+      }
+      const HistoryRecord* before = nullptr;
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        HistoryRecord& record = result[i];
+        if (after[i] && after[i]->Timestamp == record.Timestamp)
+        {
+          record.Value = after[i]->Value;
+          record.Status = 0;
+        }
+        else if (before && after[i])
+        {
+          record.Value = Interpolate(*before, *after[i], record.Timestamp);
+          record.Status = 0;
+        }
+        before = intervals[i].HasGood ? &intervals[i].Last : before;
+      }
+    }
+    return result;
+  }
+
+}
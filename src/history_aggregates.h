@@ -0,0 +1,49 @@
+/// @brief Aggregates of stored history computed per processing interval.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include "history_log.h"
+
+#include <string>
+#include <vector>
+
+namespace OpcUa
+{
+
+  enum class AggregateType : uint32_t
+  {
+    Count = 0,
+    Minimum,
+    Maximum,
+    Average,
+    Interpolative, // Linear between the good samples around the start of the interval.
+  };
+
+  // Only samples with good status take part.
+  struct RangeSummary
+  {
+    std::size_t Count;
+    double Minimum;
+    double Maximum;
+    double Sum;
+  };
+
+  // Name of the kernel Summarize uses, "sse2" or "scalar".
+  const char* GetAggregateKernel();
+
+  RangeSummary Summarize(const HistoryRecord* begin, const HistoryRecord* end);
+  // The portable loop, also used for ranges with samples of bad status.
+  RangeSummary SummarizeScalar(const HistoryRecord* begin, const HistoryRecord* end);
+
+  // One record per interval of the range start <= Timestamp < end, stamped with the interval start.
+  // Intervals without data have status BadNoData. Interpolation only uses samples inside the range.
+  // Throws std::logic_error for an empty range or a non positive interval.
+  std::vector<HistoryRecord> ReadProcessed(const HistoryLog& log, const std::string& series, int64_t start, int64_t end, int64_t interval, AggregateType type);
+
+}
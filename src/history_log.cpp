@@ -0,0 +1,532 @@
+/// @brief Append only value history stored in memory mapped segment files.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "history_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace
+{
+  const char SegmentMagic[8] = {'O', 'P', 'C', 'H', 'I', 'S', 'T', '1'};
+  const uint32_t SegmentVersion = 1;
+  const char* SegmentExtension = ".seg";
+
+  void ThrowSystemError(const std::string& what, const std::string& path)
+  {
+    std::stringstream stream;
+    stream << what << " '" << path << "': " << std::strerror(errno);
+    throw std::runtime_error(stream.str());
+  }
+
+  void MakeDirectory(const std::string& path)
+  {
+    std::string::size_type pos = 0;
+    do
+    {
+      pos = path.find('/', pos + 1);
+      const std::string dir = path.substr(0, pos);
+      if (::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+      {
+        ThrowSystemError("Unable to create directory", dir);
+      }
+    }
+    while (pos != std::string::npos);
+  }
+
+  // Series names are node ids like "ns=2;s=Foo", which can hold anything. Hex keeps them file system safe.
+  std::string GetSeriesDirectory(const std::string& name)
+  {
+    static const char digits[] = "0123456789abcdef";
+    std::string result;
+    result.reserve(name.size() * 2);
+    for (unsigned char c : name)
+    {
+      result += digits[c >> 4];
+      result += digits[c & 0xf];
+    }
+    return result.empty() ? std::string("_") : result;
+  }
+
+  std::string GetSegmentName(uint64_t sequence)
+  {
+    char name[32] = {0};
+    std::snprintf(name, sizeof(name), "%016llx%s", static_cast<unsigned long long>(sequence), SegmentExtension);
+    return name;
+  }
+
+  std::size_t GetPageSize()
+  {
+    static const std::size_t pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return pageSize;
+  }
+
+  void Sync(void* addr, std::size_t size)
+  {
+    const std::size_t pageSize = GetPageSize();
+    char* begin = static_cast<char*>(addr);
+    char* aligned = begin - (reinterpret_cast<uintptr_t>(begin) % pageSize);
+    if (::msync(aligned, size + (begin - aligned), MS_SYNC) != 0)
+    {
+      throw std::runtime_error(std::string("Unable to sync history segment: ") + std::strerror(errno));
+    }
+  }
+}
+
+namespace OpcUa
+{
+
+  struct HistorySegment::Header
+  {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t RecordSize;
+    uint64_t Capacity;
+    uint64_t Count;
+    int64_t FirstTimestamp;
+    int64_t LastTimestamp;
+    uint8_t Reserved[16];
+  };
+
+  HistorySegment::HistorySegment(const std::string& path, std::size_t capacity)
+    : Path(path)
+    , File(-1)
+    , Size(sizeof(Header) + capacity * sizeof(HistoryRecord))
+    , Hdr(nullptr)
+    , Records(nullptr)
+    , Pending(0)
+  {
+    File = ::open(Path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (File < 0)
+    {
+      ThrowSystemError("Unable to create history segment", Path);
+    }
+    if (::ftruncate(File, Size) != 0)
+    {
+      ::close(File);
+      ThrowSystemError("Unable to allocate history segment", Path);
+    }
+    Map(Size);
+    std::memcpy(Hdr->Magic, SegmentMagic, sizeof(SegmentMagic));
+    Hdr->Version = SegmentVersion;
+    Hdr->RecordSize = sizeof(HistoryRecord);
+    Hdr->Capacity = capacity;
+    Hdr->Count = 0;
+    Hdr->FirstTimestamp = 0;
+    Hdr->LastTimestamp = 0;
+    ::Sync(Hdr, sizeof(Header));
+  }
+
+  HistorySegment::HistorySegment(const std::string& path)
+    : Path(path)
+    , File(-1)
+    , Size(0)
+    , Hdr(nullptr)
+    , Records(nullptr)
+    , Pending(0)
+  {
+    File = ::open(Path.c_str(), O_RDWR);
+    if (File < 0)
+    {
+      ThrowSystemError("Unable to open history segment", Path);
+    }
+    struct stat info;
+    if (::fstat(File, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(Header))
+    {
+      ::close(File);
+      throw std::logic_error("History segment '" + Path + "' is truncated.");
+    }
+    Size = info.st_size;
+    Map(Size);
+    const bool valid = std::memcmp(Hdr->Magic, SegmentMagic, sizeof(SegmentMagic)) == 0
+      && Hdr->Version == SegmentVersion
+      && Hdr->RecordSize == sizeof(HistoryRecord)
+      && Hdr->Count <= Hdr->Capacity
+      && sizeof(Header) + Hdr->Capacity * sizeof(HistoryRecord) <= Size;
+    if (!valid)
+    {
+      ::munmap(Hdr, Size);
+      ::close(File);
+      throw std::logic_error("History segment '" + Path + "' has invalid format.");
+    }
+  }
+
+  HistorySegment::~HistorySegment()
+  {
+    ::munmap(Hdr, Size);
+    ::close(File);
+  }
+
+  void HistorySegment::Map(std::size_t fileSize)
+  {
+    void* addr = ::mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0);
+    if (addr == MAP_FAILED)
+    {
+      ::close(File);
+      ThrowSystemError("Unable to map history segment", Path);
+    }
+    Hdr = static_cast<Header*>(addr);
+    Records = reinterpret_cast<HistoryRecord*>(static_cast<char*>(addr) + sizeof(Header));
+  }
+
+  std::size_t HistorySegment::GetCount() const
+  {
+    return Hdr->Count;
+  }
+
+  std::size_t HistorySegment::GetCapacity() const
+  {
+    return Hdr->Capacity;
+  }
+
+  int64_t HistorySegment::GetFirstTimestamp() const
+  {
+    return Hdr->FirstTimestamp;
+  }
+
+  int64_t HistorySegment::GetLastTimestamp() const
+  {
+    return Hdr->LastTimestamp;
+  }
+
+  std::size_t HistorySegment::Write(const HistoryRecord* records, std::size_t count)
+  {
+    const std::size_t used = Hdr->Count + Pending;
+    const std::size_t written = std::min(count, static_cast<std::size_t>(Hdr->Capacity) - used);
+    std::copy(records, records + written, Records + used);
+    Pending += written;
+    return written;
+  }
+
+  void HistorySegment::Sync()
+  {
+    if (Pending)
+    {
+      ::Sync(Records + Hdr->Count, Pending * sizeof(HistoryRecord));
+    }
+  }
+
+  // Records have to be synced before the header points at them.
+  void HistorySegment::Commit()
+  {
+    if (!Pending)
+    {
+      return;
+    }
+    if (!Hdr->Count)
+    {
+      Hdr->FirstTimestamp = Records[0].Timestamp;
+    }
+    Hdr->Count += Pending;
+    Hdr->LastTimestamp = Records[Hdr->Count - 1].Timestamp;
+    Pending = 0;
+    ::Sync(Hdr, sizeof(Header));
+  }
+
+  std::pair<const HistoryRecord*, const HistoryRecord*> HistorySegment::Find(int64_t start, int64_t end) const
+  {
+    const HistoryRecord* begin = Records;
+    const HistoryRecord* last = Records + Hdr->Count;
+    auto less = [](const HistoryRecord& record, int64_t timestamp) { return record.Timestamp < timestamp; };
+    const HistoryRecord* first = std::lower_bound(begin, last, start, less);
+    const HistoryRecord* stop = std::lower_bound(first, last, end, less);
+    return std::make_pair(first, stop);
+  }
+
+
+  HistoryLog::HistoryLog(const std::string& directory, std::size_t recordsPerSegment, unsigned commitIntervalMs)
+    : Directory(directory)
+    , RecordsPerSegment(recordsPerSegment ? recordsPerSegment : 1)
+    , CommitInterval(commitIntervalMs)
+    , QueuedGeneration(0)
+    , CommittedGeneration(0)
+    , FlushRequested(false)
+    , Stopping(false)
+    , Appended(0)
+    , Committed(0)
+    , Dropped(0)
+    , Failed(0)
+    , Commits(0)
+    , SegmentsRemoved(0)
+  {
+    MakeDirectory(Directory);
+    Writer = std::thread([this](){ Run(); });
+  }
+
+  HistoryLog::~HistoryLog()
+  {
+    {
+      std::unique_lock<std::mutex> lock(QueueMutex);
+      Stopping = true;
+    }
+    QueueCondition.notify_all();
+    Writer.join();
+  }
+
+  void HistoryLog::SetRetention(const HistoryRetention& retention)
+  {
+    std::unique_lock<std::mutex> lock(SeriesMutex);
+    Retention = retention;
+  }
+
+  void HistoryLog::Append(const std::string& series, const HistoryRecord& record)
+  {
+    std::unique_lock<std::mutex> lock(QueueMutex);
+    Queue.push_back(std::make_pair(series, record));
+    ++QueuedGeneration;
+    ++Appended;
+  }
+
+  void HistoryLog::Flush()
+  {
+    std::unique_lock<std::mutex> lock(QueueMutex);
+    const uint64_t generation = QueuedGeneration;
+    FlushRequested = true;
+    QueueCondition.notify_all();
+    FlushCondition.wait(lock, [this, generation](){ return CommittedGeneration >= generation; });
+  }
+
+  void HistoryLog::Scan(const std::string& name, int64_t start, int64_t end, const RangeCallback& callback) const
+  {
+    std::unique_lock<std::mutex> lock(SeriesMutex);
+    const Series& series = GetSeries(name);
+    for (const std::unique_ptr<HistorySegment>& segment : series.Segments)
+    {
+      if (!segment->GetCount() || segment->GetLastTimestamp() < start || segment->GetFirstTimestamp() >= end)
+      {
+        continue;
+      }
+      const std::pair<const HistoryRecord*, const HistoryRecord*> range = segment->Find(start, end);
+      if (range.first != range.second)
+      {
+        callback(range.first, range.second);
+      }
+    }
+  }
+
+  std::vector<HistoryRecord> HistoryLog::Read(const std::string& series, int64_t start, int64_t end, std::size_t maxValues) const
+  {
+    std::vector<HistoryRecord> result;
+    Scan(series, start, end, [&result, maxValues](const HistoryRecord* begin, const HistoryRecord* last)
+      {
+        if (maxValues)
+        {
+          last = std::min(last, begin + (maxValues - std::min(maxValues, result.size())));
+        }
+        result.insert(result.end(), begin, last);
+      });
+    return result;
+  }
+
+  HistoryStats HistoryLog::GetStats() const
+  {
+    HistoryStats stats;
+    stats.Appended = Appended;
+    stats.Committed = Committed;
+    stats.Dropped = Dropped;
+    stats.Failed = Failed;
+    stats.Commits = Commits;
+    stats.SegmentsRemoved = SegmentsRemoved;
+    return stats;
+  }
+
+  // Must be called under SeriesMutex.
+  HistoryLog::Series& HistoryLog::GetSeries(const std::string& name) const
+  {
+    std::map<std::string, std::unique_ptr<Series>>::iterator it = AllSeries.find(name);
+    if (it != AllSeries.end())
+    {
+      return *it->second;
+    }
+    std::unique_ptr<Series> series(new Series);
+    series->Directory = Directory + "/" + GetSeriesDirectory(name);
+    series->NextSequence = 0;
+    series->LastTimestamp = 0;
+    OpenSegments(*series);
+    Series& result = *series;
+    AllSeries.insert(std::make_pair(name, std::move(series)));
+    return result;
+  }
+
+  void HistoryLog::OpenSegments(Series& series) const
+  {
+    DIR* dir = ::opendir(series.Directory.c_str());
+    if (!dir)
+    {
+      return;
+    }
+    std::vector<uint64_t> sequences;
+    while (dirent* entry = ::readdir(dir))
+    {
+      const std::string name = entry->d_name;
+      const std::string::size_type ext = name.rfind(SegmentExtension);
+      if (ext == std::string::npos || ext + std::strlen(SegmentExtension) != name.size())
+      {
+        continue;
+      }
+      sequences.push_back(std::strtoull(name.substr(0, ext).c_str(), nullptr, 16));
+    }
+    ::closedir(dir);
+
+    std::sort(sequences.begin(), sequences.end());
+    for (uint64_t sequence : sequences)
+    {
+      std::unique_ptr<HistorySegment> segment(new HistorySegment(series.Directory + "/" + GetSegmentName(sequence)));
+      if (segment->GetCount())
+      {
+        series.LastTimestamp = segment->GetLastTimestamp();
+      }
+      series.Segments.push_back(std::move(segment));
+      series.NextSequence = sequence + 1;
+    }
+  }
+
+  void HistoryLog::Run()
+  {
+    std::unique_lock<std::mutex> lock(QueueMutex);
+    for (;;)
+    {
+      QueueCondition.wait_for(lock, std::chrono::milliseconds(CommitInterval), [this](){ return Stopping || FlushRequested; });
+      std::vector<std::pair<std::string, HistoryRecord>> batch;
+      batch.swap(Queue);
+      const uint64_t generation = QueuedGeneration;
+      const bool stopping = Stopping;
+      FlushRequested = false;
+      lock.unlock();
+
+      if (!batch.empty())
+      {
+        try
+        {
+          Commit(batch);
+        }
+        catch (const std::exception&)
+        {
+          Failed += batch.size();
+        }
+      }
+
+      lock.lock();
+      CommittedGeneration = generation;
+      FlushCondition.notify_all();
+      if (stopping && Queue.empty())
+      {
+        return;
+      }
+    }
+  }
+
+  void HistoryLog::Commit(std::vector<std::pair<std::string, HistoryRecord>>& batch)
+  {
+    std::stable_sort(batch.begin(), batch.end(),
+      [](const std::pair<std::string, HistoryRecord>& a, const std::pair<std::string, HistoryRecord>& b)
+      {
+        return a.first < b.first || (a.first == b.first && a.second.Timestamp < b.second.Timestamp);
+      });
+
+    std::vector<HistoryRecord> records;
+    for (std::size_t begin = 0; begin < batch.size();)
+    {
+      std::size_t end = begin;
+      records.clear();
+      while (end < batch.size() && batch[end].first == batch[begin].first)
+      {
+        records.push_back(batch[end].second);
+        ++end;
+      }
+
+      Series* series = nullptr;
+      {
+        std::unique_lock<std::mutex> lock(SeriesMutex);
+        series = &GetSeries(batch[begin].first);
+      }
+      Store(*series, records.data(), records.size());
+      begin = end;
+    }
+    ++Commits;
+  }
+
+  // Only the writer thread changes segments, readers are kept out by SeriesMutex while it publishes.
+  void HistoryLog::Store(Series& series, const HistoryRecord* records, std::size_t count)
+  {
+    const HistoryRecord* end = records + count;
+    const HistoryRecord* begin = std::lower_bound(records, end, series.LastTimestamp,
+      [](const HistoryRecord& record, int64_t timestamp) { return record.Timestamp < timestamp; });
+    Dropped += begin - records;
+    if (begin == end)
+    {
+      return;
+    }
+    const std::size_t stored = end - begin;
+
+    std::vector<HistorySegment*> touched;
+    while (begin != end)
+    {
+      HistorySegment* segment = series.Segments.empty() ? nullptr : series.Segments.back().get();
+      if (!segment || segment->GetCount() == segment->GetCapacity())
+      {
+        MakeDirectory(series.Directory);
+        std::unique_ptr<HistorySegment> created(new HistorySegment(series.Directory + "/" + GetSegmentName(series.NextSequence), RecordsPerSegment));
+        segment = created.get();
+        std::unique_lock<std::mutex> lock(SeriesMutex);
+        series.Segments.push_back(std::move(created));
+        ++series.NextSequence;
+      }
+      const std::size_t written = segment->Write(begin, end - begin);
+      begin += written;
+      touched.push_back(segment);
+      segment->Sync();
+      if (begin != end)
+      {
+        // Segment is full: publish it so that the next one starts from a committed state.
+        std::unique_lock<std::mutex> lock(SeriesMutex);
+        segment->Commit();
+      }
+    }
+
+    std::unique_lock<std::mutex> lock(SeriesMutex);
+    for (HistorySegment* segment : touched)
+    {
+      segment->Commit();
+    }
+    series.LastTimestamp = (end - 1)->Timestamp;
+    Committed += stored;
+    ApplyRetention(series);
+  }
+
+  void HistoryLog::ApplyRetention(Series& series)
+  {
+    while (series.Segments.size() > 1)
+    {
+      const HistorySegment& oldest = *series.Segments.front();
+      const bool tooMany = Retention.MaxSegments && series.Segments.size() > Retention.MaxSegments;
+      const bool tooOld = Retention.MaxAge && oldest.GetLastTimestamp() < series.LastTimestamp - Retention.MaxAge;
+      if (!tooMany && !tooOld)
+      {
+        break;
+      }
+      const std::string path = oldest.GetPath();
+      series.Segments.pop_front();
+      ::unlink(path.c_str());
+      ++SegmentsRemoved;
+    }
+  }
+
+}
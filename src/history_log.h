@@ -0,0 +1,187 @@
+/// @brief Append only value history stored in memory mapped segment files.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace OpcUa
+{
+
+  // One stored sample. Timestamp is OPC UA DateTime (100ns ticks since 1601).
+  struct HistoryRecord
+  {
+    int64_t Timestamp;
+    double Value;
+    uint32_t Status;
+    uint32_t Reserved;
+
+    HistoryRecord()
+      : Timestamp(0)
+      , Value(0)
+      , Status(0)
+      , Reserved(0)
+    {
+    }
+
+    HistoryRecord(int64_t timestamp, double value, uint32_t status)
+      : Timestamp(timestamp)
+      , Value(value)
+      , Status(status)
+      , Reserved(0)
+    {
+    }
+  };
+
+  // Retention removes whole segments, oldest first. Segments are never compacted:
+  // partly expired segments are kept as they are and old samples are not downsampled.
+  struct HistoryRetention
+  {
+    std::size_t MaxSegments; // Per series, 0 - keep everything.
+    int64_t MaxAge;          // In DateTime ticks relative to the newest sample, 0 - keep everything.
+
+    HistoryRetention()
+      : MaxSegments(0)
+      , MaxAge(0)
+    {
+    }
+  };
+
+  struct HistoryStats
+  {
+    uint64_t Appended;
+    uint64_t Committed;
+    uint64_t Dropped;   // Samples older than the last stored one of the series.
+    uint64_t Failed;    // Samples lost because their commit failed, e.g. the disk is full.
+    uint64_t Commits;
+    uint64_t SegmentsRemoved;
+  };
+
+  // Fixed size file with a header and a contiguous array of records.
+  // Records are kept in timestamp order, so the records themselves are the time index.
+  class HistorySegment
+  {
+  public:
+    HistorySegment(const std::string& path, std::size_t capacity);
+    explicit HistorySegment(const std::string& path);
+    ~HistorySegment();
+
+    HistorySegment(const HistorySegment&) = delete;
+    HistorySegment& operator=(const HistorySegment&) = delete;
+
+    const std::string& GetPath() const { return Path; }
+    std::size_t GetCount() const;
+    std::size_t GetCapacity() const;
+    int64_t GetFirstTimestamp() const;
+    int64_t GetLastTimestamp() const;
+
+    // Write records behind the committed count. They stay invisible until Commit.
+    std::size_t Write(const HistoryRecord* records, std::size_t count);
+    // Flush written records to disk.
+    void Sync();
+    // Make synced records visible to readers and persist the header.
+    void Commit();
+
+    // Committed records with start <= Timestamp < end.
+    std::pair<const HistoryRecord*, const HistoryRecord*> Find(int64_t start, int64_t end) const;
+
+  private:
+    void Map(std::size_t fileSize);
+
+  private:
+    struct Header;
+
+    std::string Path;
+    int File;
+    std::size_t Size;
+    Header* Hdr;
+    HistoryRecord* Records;
+    std::size_t Pending;
+  };
+
+  class HistoryLog
+  {
+  public:
+    typedef std::shared_ptr<HistoryLog> SharedPtr;
+    typedef std::function<void (const HistoryRecord* begin, const HistoryRecord* end)> RangeCallback;
+
+    HistoryLog(const std::string& directory, std::size_t recordsPerSegment = 1 << 16, unsigned commitIntervalMs = 100);
+    ~HistoryLog();
+
+    HistoryLog(const HistoryLog&) = delete;
+    HistoryLog& operator=(const HistoryLog&) = delete;
+
+    void SetRetention(const HistoryRetention& retention);
+
+    // Queue a sample. It is written and synced by the background thread with the other pending samples.
+    void Append(const std::string& series, const HistoryRecord& record);
+    // Block until every sample queued before the call is on disk.
+    void Flush();
+
+    // Pass contiguous slices of the mapped segments to the callback, oldest first.
+    // The slices are valid only inside the callback.
+    void Scan(const std::string& series, int64_t start, int64_t end, const RangeCallback& callback) const;
+    std::vector<HistoryRecord> Read(const std::string& series, int64_t start, int64_t end, std::size_t maxValues = 0) const;
+
+    HistoryStats GetStats() const;
+
+  private:
+    struct Series
+    {
+      std::string Directory;
+      std::deque<std::unique_ptr<HistorySegment>> Segments;
+      uint64_t NextSequence;
+      int64_t LastTimestamp;
+    };
+
+    Series& GetSeries(const std::string& name) const;
+    void OpenSegments(Series& series) const;
+    void Run();
+    void Commit(std::vector<std::pair<std::string, HistoryRecord>>& batch);
+    void Store(Series& series, const HistoryRecord* records, std::size_t count);
+    void ApplyRetention(Series& series);
+
+  private:
+    const std::string Directory;
+    const std::size_t RecordsPerSegment;
+    const unsigned CommitInterval;
+    HistoryRetention Retention;
+
+    mutable std::mutex SeriesMutex;
+    mutable std::map<std::string, std::unique_ptr<Series>> AllSeries;
+
+    std::mutex QueueMutex;
+    std::condition_variable QueueCondition;
+    std::condition_variable FlushCondition;
+    std::vector<std::pair<std::string, HistoryRecord>> Queue;
+    uint64_t QueuedGeneration;
+    uint64_t CommittedGeneration;
+    bool FlushRequested;
+    bool Stopping;
+
+    std::atomic<uint64_t> Appended;
+    std::atomic<uint64_t> Committed;
+    std::atomic<uint64_t> Dropped;
+    std::atomic<uint64_t> Failed;
+    std::atomic<uint64_t> Commits;
+    std::atomic<uint64_t> SegmentsRemoved;
+
+    std::thread Writer;
+  };
+
+}
@@ -0,0 +1,400 @@
+/// @brief Standard address space nodes created when they are first used.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "lazy_address_space.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+  using namespace OpcUa;
+
+  const uint32_t Organizes = 35;
+  const uint32_t HasSubtype = 45;
+  const uint32_t HasProperty = 46;
+  const uint32_t HasComponent = 47;
+
+  const uint32_t RootFolder = 84;
+  const uint32_t ObjectsFolder = 85;
+  const uint32_t FolderType = 61;
+  const uint32_t ServerObject = 2253;
+
+  // Folders and the type system, loaded at start. Parents come before their children.
+  const StandardNode CoreNodes[] =
+  {
+    {84, 0, 0, NodeClass::Object, StandardValue::Empty, "Root"},
+    {85, 84, Organizes, NodeClass::Object, StandardValue::Empty, "Objects"},
+    {86, 84, Organizes, NodeClass::Object, StandardValue::Empty, "Types"},
+    {87, 84, Organizes, NodeClass::Object, StandardValue::Empty, "Views"},
+    {88, 86, Organizes, NodeClass::Object, StandardValue::Empty, "ObjectTypes"},
+    {89, 86, Organizes, NodeClass::Object, StandardValue::Empty, "VariableTypes"},
+    {90, 86, Organizes, NodeClass::Object, StandardValue::Empty, "DataTypes"},
+    {91, 86, Organizes, NodeClass::Object, StandardValue::Empty, "ReferenceTypes"},
+
+    {58, 88, Organizes, NodeClass::ObjectType, StandardValue::Empty, "BaseObjectType"},
+    {61, 58, HasSubtype, NodeClass::ObjectType, StandardValue::Empty, "FolderType"},
+    {2004, 58, HasSubtype, NodeClass::ObjectType, StandardValue::Empty, "ServerType"},
+    {2013, 58, HasSubtype, NodeClass::ObjectType, StandardValue::Empty, "ServerCapabilitiesType"},
+    {2020, 58, HasSubtype, NodeClass::ObjectType, StandardValue::Empty, "ServerDiagnosticsType"},
+    {2033, 58, HasSubtype, NodeClass::ObjectType, StandardValue::Empty, "VendorServerInfoType"},
+    {2034, 58, HasSubtype, NodeClass::ObjectType, StandardValue::Empty, "ServerRedundancyType"},
+    {2041, 58, HasSubtype, NodeClass::ObjectType, StandardValue::Empty, "BaseEventType"},
+
+    {62, 89, Organizes, NodeClass::VariableType, StandardValue::Empty, "BaseVariableType"},
+    {63, 62, HasSubtype, NodeClass::VariableType, StandardValue::Empty, "BaseDataVariableType"},
+    {68, 62, HasSubtype, NodeClass::VariableType, StandardValue::Empty, "PropertyType"},
+    {2138, 63, HasSubtype, NodeClass::VariableType, StandardValue::Empty, "ServerStatusType"},
+
+    {24, 90, Organizes, NodeClass::DataType, StandardValue::Empty, "BaseDataType"},
+    {1, 24, HasSubtype, NodeClass::DataType, StandardValue::Empty, "Boolean"},
+    {12, 24, HasSubtype, NodeClass::DataType, StandardValue::Empty, "String"},
+    {13, 24, HasSubtype, NodeClass::DataType, StandardValue::Empty, "DateTime"},
+    {14, 24, HasSubtype, NodeClass::DataType, StandardValue::Empty, "Guid"},
+    {15, 24, HasSubtype, NodeClass::DataType, StandardValue::Empty, "ByteString"},
+    {16, 24, HasSubtype, NodeClass::DataType, StandardValue::Empty, "XmlElement"},
+    {17, 24, HasSubtype, NodeClass::DataType, StandardValue::Empty, "NodeId"},
+    {19, 24, HasSubtype, NodeClass::DataType, StandardValue::Empty, "StatusCode"},
+    {20, 24, HasSubtype, NodeClass::DataType, StandardValue::Empty, "QualifiedName"},
+    {21, 24, HasSubtype, NodeClass::DataType, StandardValue::Empty, "LocalizedText"},
+    {22, 24, HasSubtype, NodeClass::DataType, StandardValue::Empty, "Structure"},
+    {26, 24, HasSubtype, NodeClass::DataType, StandardValue::Empty, "Number"},
+    {10, 26, HasSubtype, NodeClass::DataType, StandardValue::Empty, "Float"},
+    {11, 26, HasSubtype, NodeClass::DataType, StandardValue::Empty, "Double"},
+    {27, 26, HasSubtype, NodeClass::DataType, StandardValue::Empty, "Integer"},
+    {28, 26, HasSubtype, NodeClass::DataType, StandardValue::Empty, "UInteger"},
+    {2, 27, HasSubtype, NodeClass::DataType, StandardValue::Empty, "SByte"},
+    {4, 27, HasSubtype, NodeClass::DataType, StandardValue::Empty, "Int16"},
+    {6, 27, HasSubtype, NodeClass::DataType, StandardValue::Empty, "Int32"},
+    {8, 27, HasSubtype, NodeClass::DataType, StandardValue::Empty, "Int64"},
+    {3, 28, HasSubtype, NodeClass::DataType, StandardValue::Empty, "Byte"},
+    {5, 28, HasSubtype, NodeClass::DataType, StandardValue::Empty, "UInt16"},
+    {7, 28, HasSubtype, NodeClass::DataType, StandardValue::Empty, "UInt32"},
+    {9, 28, HasSubtype, NodeClass::DataType, StandardValue::Empty, "UInt64"},
+    {290, 11, HasSubtype, NodeClass::DataType, StandardValue::Empty, "Duration"},
+    {294, 13, HasSubtype, NodeClass::DataType, StandardValue::Empty, "UtcTime"},
+
+    {31, 91, Organizes, NodeClass::ReferenceType, StandardValue::Empty, "References"},
+    {32, 31, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "NonHierarchicalReferences"},
+    {33, 31, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "HierarchicalReferences"},
+    {34, 33, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "HasChild"},
+    {35, 33, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "Organizes"},
+    {36, 33, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "HasEventSource"},
+    {48, 36, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "HasNotifier"},
+    {44, 34, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "Aggregates"},
+    {45, 34, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "HasSubtype"},
+    {46, 44, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "HasProperty"},
+    {47, 44, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "HasComponent"},
+    {49, 47, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "HasOrderedComponent"},
+    {37, 32, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "HasModellingRule"},
+    {38, 32, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "HasEncoding"},
+    {39, 32, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "HasDescription"},
+    {40, 32, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "HasTypeDefinition"},
+    {41, 32, HasSubtype, NodeClass::ReferenceType, StandardValue::Empty, "GeneratesEvent"},
+  };
+
+  // Sorted by id. Nodes below the Objects folder are added at start, the others on first use.
+  const StandardNode LazyNodes[] =
+  {
+    {2042, 2041, HasProperty, NodeClass::Variable, StandardValue::Empty, "EventId"},
+    {2043, 2041, HasProperty, NodeClass::Variable, StandardValue::Empty, "EventType"},
+    {2044, 2041, HasProperty, NodeClass::Variable, StandardValue::Empty, "SourceNode"},
+    {2045, 2041, HasProperty, NodeClass::Variable, StandardValue::String, "SourceName"},
+    {2046, 2041, HasProperty, NodeClass::Variable, StandardValue::DateTime, "Time"},
+    {2047, 2041, HasProperty, NodeClass::Variable, StandardValue::DateTime, "ReceiveTime"},
+    {2050, 2041, HasProperty, NodeClass::Variable, StandardValue::String, "Message"},
+    {2051, 2041, HasProperty, NodeClass::Variable, StandardValue::UInt16, "Severity"},
+    {2253, 85, Organizes, NodeClass::Object, StandardValue::Empty, "Server", 2004},
+    {2254, 2253, HasProperty, NodeClass::Variable, StandardValue::Servers, "ServerArray"},
+    {2255, 2253, HasProperty, NodeClass::Variable, StandardValue::Namespaces, "NamespaceArray"},
+    {2256, 2253, HasComponent, NodeClass::Variable, StandardValue::Empty, "ServerStatus"},
+    {2257, 2256, HasComponent, NodeClass::Variable, StandardValue::DateTime, "StartTime"},
+    {2258, 2256, HasComponent, NodeClass::Variable, StandardValue::DateTime, "CurrentTime"},
+    {2259, 2256, HasComponent, NodeClass::Variable, StandardValue::Int32, "State"},
+    {2260, 2256, HasComponent, NodeClass::Variable, StandardValue::Empty, "BuildInfo"},
+    {2261, 2260, HasComponent, NodeClass::Variable, StandardValue::String, "ProductName"},
+    {2262, 2260, HasComponent, NodeClass::Variable, StandardValue::String, "ProductUri"},
+    {2263, 2260, HasComponent, NodeClass::Variable, StandardValue::String, "ManufacturerName"},
+    {2264, 2260, HasComponent, NodeClass::Variable, StandardValue::String, "SoftwareVersion"},
+    {2265, 2260, HasComponent, NodeClass::Variable, StandardValue::String, "BuildNumber"},
+    {2266, 2260, HasComponent, NodeClass::Variable, StandardValue::DateTime, "BuildDate"},
+    {2267, 2253, HasProperty, NodeClass::Variable, StandardValue::Byte, "ServiceLevel"},
+    {2268, 2253, HasComponent, NodeClass::Object, StandardValue::Empty, "ServerCapabilities", 2013},
+    {2269, 2268, HasProperty, NodeClass::Variable, StandardValue::Empty, "ServerProfileArray"},
+    {2271, 2268, HasProperty, NodeClass::Variable, StandardValue::Empty, "LocaleIdArray"},
+    {2272, 2268, HasProperty, NodeClass::Variable, StandardValue::Double, "MinSupportedSampleRate"},
+    {2274, 2253, HasComponent, NodeClass::Object, StandardValue::Empty, "ServerDiagnostics", 2020},
+    {2294, 2274, HasProperty, NodeClass::Variable, StandardValue::Boolean, "EnabledFlag"},
+    {2295, 2253, HasComponent, NodeClass::Object, StandardValue::Empty, "VendorServerInfo", 2033},
+    {2296, 2253, HasComponent, NodeClass::Object, StandardValue::Empty, "ServerRedundancy", 2034},
+    {2735, 2268, HasProperty, NodeClass::Variable, StandardValue::UInt16, "MaxBrowseContinuationPoints"},
+    {2736, 2268, HasProperty, NodeClass::Variable, StandardValue::UInt16, "MaxQueryContinuationPoints"},
+    {2737, 2268, HasProperty, NodeClass::Variable, StandardValue::UInt16, "MaxHistoryContinuationPoints"},
+    {2992, 2256, HasComponent, NodeClass::Variable, StandardValue::UInt32, "SecondsTillShutdown"},
+    {2993, 2256, HasComponent, NodeClass::Variable, StandardValue::Empty, "ShutdownReason"},
+    {2994, 2253, HasProperty, NodeClass::Variable, StandardValue::Boolean, "Auditing"},
+    {2996, 2268, HasComponent, NodeClass::Object, StandardValue::Empty, "ModellingRules", FolderType},
+    {2997, 2268, HasComponent, NodeClass::Object, StandardValue::Empty, "AggregateFunctions", FolderType},
+    {3190, 2041, HasProperty, NodeClass::Variable, StandardValue::Empty, "LocalTime"},
+  };
+
+  const std::size_t LazyCount = sizeof(LazyNodes) / sizeof(LazyNodes[0]);
+
+  // Index into LazyNodes, or LazyCount.
+  std::size_t FindLazy(uint32_t id)
+  {
+    const StandardNode* found = std::lower_bound(std::begin(LazyNodes), std::end(LazyNodes), id, [](const StandardNode& node, uint32_t value) { return node.Id < value; });
+    return found != std::end(LazyNodes) && found->Id == id ? found - std::begin(LazyNodes) : LazyCount;
+  }
+
+  // Nodes below the Objects folder, as opposed to the ones below a type.
+  bool IsInstance(std::size_t index)
+  {
+    uint32_t parent = LazyNodes[index].Parent;
+    for (std::size_t i = FindLazy(parent); i != LazyCount; i = FindLazy(parent))
+    {
+      parent = LazyNodes[i].Parent;
+    }
+    return parent == ObjectsFolder;
+  }
+
+  const StandardNode* FindCoreChild(uint32_t parent, const std::string& name)
+  {
+    for (const StandardNode& node : CoreNodes)
+    {
+      if (node.Parent == parent && name == node.Name)
+      {
+        return &node;
+      }
+    }
+    return nullptr;
+  }
+
+  bool IsStandard(const NodeID& id)
+  {
+    return id.IsInteger() && id.GetNamespaceIndex() == 0;
+  }
+
+  const char* GetClassName(NodeClass nodeClass)
+  {
+    switch (nodeClass)
+    {
+      case NodeClass::Variable: return "variable";
+      case NodeClass::ObjectType: return "object_type";
+      case NodeClass::VariableType: return "variable_type";
+      case NodeClass::ReferenceType: return "reference_type";
+      case NodeClass::DataType: return "data_type";
+      default: return "object";
+    }
+  }
+
+  const char* GetReferenceName(uint32_t reference)
+  {
+    switch (reference)
+    {
+      case HasSubtype: return "has_subtype";
+      case HasProperty: return "has_property";
+      case HasComponent: return "has_component";
+      default: return "organizes";
+    }
+  }
+
+  Variant GetValue(StandardValue value, const std::string& serverURI)
+  {
+    switch (value)
+    {
+      case StandardValue::Boolean: return Variant(false);
+      case StandardValue::Byte: return Variant(static_cast<uint8_t>(255));
+      case StandardValue::UInt16: return Variant(static_cast<uint16_t>(0));
+      case StandardValue::UInt32: return Variant(static_cast<uint32_t>(0));
+      case StandardValue::Int32: return Variant(static_cast<int32_t>(0)); // ServerState Running.
+      case StandardValue::Double: return Variant(0.0);
+      case StandardValue::DateTime: return Variant(CurrentDateTime());
+      case StandardValue::String: return Variant(std::string());
+      case StandardValue::Namespaces: return Variant(std::vector<std::string>(1, "http://opcfoundation.org/UA/"));
+      case StandardValue::Servers: return Variant(std::vector<std::string>(1, serverURI));
+      default: return Variant();
+    }
+  }
+}
+
+namespace OpcUa
+{
+
+  void LazyAddressSpace::WriteCoreXml(std::ostream& out)
+  {
+    out << "<?xml version=\"1.0\"?>\n<address_space version=\"1\">\n";
+    for (const StandardNode& node : CoreNodes)
+    {
+      out << "  <node>\n    <attributes>\n";
+      out << "      <id type=\"numeric\">" << node.Id << "</id>\n";
+      out << "      <class>" << GetClassName(node.Class) << "</class>\n";
+      out << "      <browse_name>" << node.Name << "</browse_name>\n";
+      out << "      <display_name>" << node.Name << "</display_name>\n";
+      out << "    </attributes>\n    <references>\n";
+      for (const StandardNode& child : CoreNodes)
+      {
+        if (child.Parent != node.Id)
+        {
+          continue;
+        }
+        const char* reference = GetReferenceName(child.Reference);
+        out << "      <" << reference << ">\n";
+        out << "        <id type=\"numeric\">" << child.Id << "</id>\n";
+        out << "        <class>" << GetClassName(child.Class) << "</class>\n";
+        out << "        <browse_name>" << child.Name << "</browse_name>\n";
+        out << "        <display_name>" << child.Name << "</display_name>\n";
+        out << "      </" << reference << ">\n";
+      }
+      out << "    </references>\n  </node>\n";
+    }
+    out << "</address_space>\n";
+  }
+
+  LazyAddressSpace::LazyAddressSpace(Remote::Server::SharedPtr server, const std::string& serverURI)
+    : Server(server)
+    , ServerURI(serverURI)
+    , Materialized(LazyCount, false)
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    for (std::size_t i = 0; i < LazyCount; ++i)
+    {
+      if (IsInstance(i))
+      {
+        Add(i);
+      }
+    }
+  }
+
+  void LazyAddressSpace::Materialize(const NodeID& id)
+  {
+    if (!IsStandard(id))
+    {
+      return;
+    }
+    const std::size_t index = FindLazy(id.GetIntegerIdentifier());
+    if (index != LazyCount)
+    {
+      std::unique_lock<std::mutex> lock(Mutex);
+      Add(index);
+    }
+  }
+
+  void LazyAddressSpace::Materialize(const std::vector<NodeID>& ids)
+  {
+    for (const NodeID& id : ids)
+    {
+      Materialize(id);
+    }
+  }
+
+  void LazyAddressSpace::MaterializeChildren(const NodeID& id)
+  {
+    if (!IsStandard(id))
+    {
+      return;
+    }
+    const uint32_t parent = id.GetIntegerIdentifier();
+    std::unique_lock<std::mutex> lock(Mutex);
+    for (std::size_t i = 0; i < LazyCount; ++i)
+    {
+      if (LazyNodes[i].Parent == parent)
+      {
+        Add(i);
+      }
+    }
+  }
+
+  void LazyAddressSpace::MaterializePath(const std::vector<QualifiedName>& path)
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    uint32_t current = RootFolder;
+    for (const QualifiedName& name : path)
+    {
+      if (name.NamespaceIndex != 0)
+      {
+        return;
+      }
+      if (const StandardNode* core = FindCoreChild(current, name.Name))
+      {
+        current = core->Id;
+        continue;
+      }
+      std::size_t index = 0;
+      while (index < LazyCount && (LazyNodes[index].Parent != current || name.Name != LazyNodes[index].Name))
+      {
+        ++index;
+      }
+      if (index == LazyCount)
+      {
+        return;
+      }
+      Add(index);
+      current = LazyNodes[index].Id;
+    }
+  }
+
+  std::size_t LazyAddressSpace::GetMaterializedCount() const
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    return MaterializedCount;
+  }
+
+  std::size_t LazyAddressSpace::GetLazyCount() const
+  {
+    return LazyCount;
+  }
+
+  void LazyAddressSpace::Add(std::size_t index)
+  {
+    if (Materialized[index])
+    {
+      return;
+    }
+    const StandardNode& node = LazyNodes[index];
+    const std::size_t parentIndex = FindLazy(node.Parent);
+    if (parentIndex != LazyCount)
+    {
+      Add(parentIndex);
+    }
+
+    const Node parent(Server, NumericNodeID(node.Parent));
+    const NodeID id = NumericNodeID(node.Id);
+    const QualifiedName name(0, node.Name);
+    if (node.Class == NodeClass::Object)
+    {
+      // AddFolder would give every object FolderType as type definition.
+      AddNodesItem item;
+      item.ParentNodeId = parent.GetId();
+      item.ReferenceTypeId = NumericNodeID(node.Reference);
+      item.RequestedNewNodeID = id;
+      item.BrowseName = name;
+      item.Class = NodeClass::Object;
+      item.TypeDefinition = NumericNodeID(node.Type);
+      ObjectAttributes attributes;
+      attributes.DisplayName = LocalizedText(node.Name);
+      attributes.Description = LocalizedText(node.Name);
+      attributes.EventNotifier = node.Id == ServerObject ? 1 : 0; // SubscribeToEvents
+      attributes.WriteMask = 0;
+      attributes.UserWriteMask = 0;
+      item.Attributes = attributes;
+      Server->NodeManagement()->AddNodes(std::vector<AddNodesItem>(1, item));
+    }
+    else if (node.Reference == HasProperty)
+    {
+      parent.AddProperty(id, name, GetValue(node.Value, ServerURI));
+    }
+    else
+    {
+      parent.AddVariable(id, name, GetValue(node.Value, ServerURI));
+    }
+    Materialized[index] = true;
+    ++MaterializedCount;
+  }
+
+}
@@ -0,0 +1,86 @@
+/// @brief Standard address space nodes created when they are first used.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <opc/ua/node.h>
+
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace OpcUa
+{
+
+  enum class StandardValue : uint8_t
+  {
+    Empty = 0,
+    Boolean,
+    Byte,
+    UInt16,
+    UInt32,
+    Int32,
+    Double,
+    DateTime,
+    String,
+    Namespaces, // Namespace URIs of the server.
+    Servers,    // URI of the server.
+  };
+
+  // One row of the namespace 0 tables compiled into the module.
+  struct StandardNode
+  {
+    uint32_t Id;
+    uint32_t Parent;    // 0 for the root folder.
+    uint32_t Reference; // Type of the reference from the parent.
+    NodeClass Class;
+    StandardValue Value;
+    const char* Name;
+    uint32_t Type;      // Type definition of objects, 0 for other nodes.
+  };
+
+  // Namespace 0 without the C++ address space of the server: the type system and the
+  // folders are loaded at start from an XML address space and the Server object is added
+  // when the server starts. Nodes below the types, like the properties of BaseEventType,
+  // are added the first time they are looked up.
+  class LazyAddressSpace
+  {
+  public:
+    // The part loaded at start, in the format of add_xml_address_space.
+    static void WriteCoreXml(std::ostream& out);
+
+    // Adds the Server object and its children.
+    LazyAddressSpace(Remote::Server::SharedPtr server, const std::string& serverURI);
+
+    LazyAddressSpace(const LazyAddressSpace&) = delete;
+    LazyAddressSpace& operator=(const LazyAddressSpace&) = delete;
+
+    // Nodes outside namespace 0 or the tables are ignored.
+    void Materialize(const NodeID& id);
+    void Materialize(const std::vector<NodeID>& ids);
+    // Before a browse of the node.
+    void MaterializeChildren(const NodeID& id);
+    // Every node along a path of browse names from the root folder.
+    void MaterializePath(const std::vector<QualifiedName>& path);
+
+    std::size_t GetMaterializedCount() const;
+    std::size_t GetLazyCount() const;
+
+  private:
+    void Add(std::size_t index);
+
+  private:
+    const Remote::Server::SharedPtr Server;
+    const std::string ServerURI;
+    mutable std::mutex Mutex;
+    std::vector<bool> Materialized;
+    std::size_t MaterializedCount = 0;
+  };
+
+}
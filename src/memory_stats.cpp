@@ -0,0 +1,242 @@
+/// @brief Estimate of the memory taken by the address space.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "memory_stats.h"
+#include "variant_numeric.h"
+
+#include <algorithm>
+#include <deque>
+#include <set>
+
+namespace
+{
+  using namespace OpcUa;
+
+  // Red-black tree node: three pointers and the color.
+  const std::size_t MapNodeOverhead = 4 * sizeof(void*);
+
+  const AttributeID AllAttributes[] =
+  {
+    AttributeID::NODE_ID, AttributeID::NODE_CLASS, AttributeID::BROWSE_NAME, AttributeID::DISPLAY_NAME,
+    AttributeID::DESCRIPTION, AttributeID::WRITE_MASK, AttributeID::USER_WRITE_MASK, AttributeID::IS_ABSTRACT,
+    AttributeID::SYMMETRIC, AttributeID::INVERSE_NAME, AttributeID::CONTAINS_NO_LOOPS, AttributeID::EVENT_NOTIFIER,
+    AttributeID::VALUE, AttributeID::DATA_TYPE, AttributeID::VALUE_RANK, AttributeID::ARRAY_DIMENSIONS,
+    AttributeID::ACCESS_LEVEL, AttributeID::USER_ACCESS_LEVEL, AttributeID::MINIMUM_SAMPLING_INTERVAL,
+    AttributeID::HISTORIZING, AttributeID::EXECUTABLE, AttributeID::USER_EXECUTABLE,
+  };
+  const std::size_t AttributeCount = sizeof(AllAttributes) / sizeof(AllAttributes[0]);
+
+  // Heap bytes of a string beyond the object itself; short strings are assumed to fit inline.
+  std::size_t StringPayload(const std::string& str)
+  {
+    return str.capacity() > 15 ? str.capacity() + 1 : 0;
+  }
+
+  std::size_t NodeIDPayload(const NodeID& id)
+  {
+    std::size_t bytes = StringPayload(id.NamespaceURI);
+    if (id.IsString())
+    {
+      bytes += StringPayload(id.StringData.Identifier);
+    }
+    else if (id.IsBinary())
+    {
+      bytes += id.BinaryData.Identifier.capacity();
+    }
+    return bytes;
+  }
+
+  struct VariantSizeVisitor
+  {
+    std::size_t Bytes;
+
+    VariantSizeVisitor()
+      : Bytes(0)
+    {
+    }
+
+    template <typename T>
+    void Visit(const std::vector<T>& values)
+    {
+      Bytes += values.capacity() * sizeof(T);
+    }
+
+    void Visit(const std::vector<bool>& values)
+    {
+      Bytes += values.capacity() / 8;
+    }
+
+    void Visit(const std::vector<std::string>& values)
+    {
+      Bytes += values.capacity() * sizeof(std::string);
+      for (const std::string& value : values)
+      {
+        Bytes += StringPayload(value);
+      }
+    }
+
+    void Visit(const std::vector<ByteString>& values)
+    {
+      Bytes += values.capacity() * sizeof(ByteString);
+      for (const ByteString& value : values)
+      {
+        Bytes += value.Data.capacity();
+      }
+    }
+
+    void Visit(const std::vector<NodeID>& values)
+    {
+      Bytes += values.capacity() * sizeof(NodeID);
+      for (const NodeID& value : values)
+      {
+        Bytes += NodeIDPayload(value);
+      }
+    }
+
+    void Visit(const std::vector<QualifiedName>& values)
+    {
+      Bytes += values.capacity() * sizeof(QualifiedName);
+      for (const QualifiedName& value : values)
+      {
+        Bytes += StringPayload(value.Name);
+      }
+    }
+
+    void Visit(const std::vector<LocalizedText>& values)
+    {
+      Bytes += values.capacity() * sizeof(LocalizedText);
+      for (const LocalizedText& value : values)
+      {
+        Bytes += StringPayload(value.Locale) + StringPayload(value.Text);
+      }
+    }
+  };
+
+  std::size_t EstimateSize(const ReferenceDescription& reference)
+  {
+    return sizeof(ReferenceDescription)
+      + NodeIDPayload(reference.ReferenceTypeID)
+      + NodeIDPayload(reference.TargetNodeID)
+      + NodeIDPayload(reference.TargetNodeTypeDefinition)
+      + StringPayload(reference.BrowseName.Name)
+      + StringPayload(reference.DisplayName.Locale)
+      + StringPayload(reference.DisplayName.Text);
+  }
+
+  std::vector<ReferenceDescription> BrowseForward(Remote::Server::SharedPtr server, const NodeID& id)
+  {
+    BrowseDescription description;
+    description.NodeToBrowse = id;
+    description.Direction = BrowseDirection::Forward;
+    description.ReferenceTypeID = ReferenceID::References;
+    description.IncludeSubtypes = true;
+    description.NodeClasses = 0;
+    description.ResultMask = BrowseResultMask::ALL;
+
+    NodesQuery query;
+    query.MaxReferenciesPerNode = 0;
+    query.NodesToBrowse.push_back(description);
+    return server->Views()->Browse(query);
+  }
+}
+
+namespace OpcUa
+{
+
+  std::size_t EstimateSize(const Variant& value)
+  {
+    VariantSizeVisitor visitor;
+    ApplyVisitor(value, visitor);
+    return sizeof(Variant) + visitor.Bytes + value.Dimensions.capacity() * sizeof(uint32_t);
+  }
+
+  std::map<NodeClass, NodeClassMemory> CollectNodeMemory(Remote::Server::SharedPtr server, const NodeID& root, std::size_t batchSize)
+  {
+    struct NodeInfo
+    {
+      NodeID Id;
+      std::size_t References;
+      std::size_t ReferenceBytes;
+    };
+
+    std::vector<NodeInfo> nodes;
+    std::set<NodeID> visited;
+    std::deque<NodeID> pending(1, root);
+    visited.insert(root);
+    while (!pending.empty())
+    {
+      NodeInfo info;
+      info.Id = pending.front();
+      info.References = 0;
+      info.ReferenceBytes = 0;
+      pending.pop_front();
+      for (const ReferenceDescription& reference : BrowseForward(server, info.Id))
+      {
+        ++info.References;
+        info.ReferenceBytes += EstimateSize(reference);
+        if (visited.insert(reference.TargetNodeID).second)
+        {
+          pending.push_back(reference.TargetNodeID);
+        }
+      }
+      nodes.push_back(info);
+    }
+
+    std::map<NodeClass, NodeClassMemory> result;
+    batchSize = std::max<std::size_t>(batchSize, 1);
+    ReadParameters params;
+    params.TimestampsType = TimestampsToReturn::NEITHER;
+    for (std::size_t begin = 0; begin < nodes.size(); begin += batchSize)
+    {
+      const std::size_t end = std::min(begin + batchSize, nodes.size());
+      params.AttributesToRead.clear();
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        for (AttributeID attribute : AllAttributes)
+        {
+          AttributeValueID value;
+          value.Node = nodes[i].Id;
+          value.Attribute = attribute;
+          params.AttributesToRead.push_back(value);
+        }
+      }
+
+      const std::vector<DataValue> values = server->Attributes()->Read(params);
+      for (std::size_t i = begin; i < end && (i - begin + 1) * AttributeCount <= values.size(); ++i)
+      {
+        const DataValue* attributes = &values[(i - begin) * AttributeCount];
+        NodeClass nodeClass = NodeClass::All;
+        std::size_t count = 0;
+        std::size_t bytes = sizeof(NodeID) + NodeIDPayload(nodes[i].Id) + MapNodeOverhead;
+        for (std::size_t attribute = 0; attribute < AttributeCount; ++attribute)
+        {
+          const DataValue& value = attributes[attribute];
+          if (!(value.Encoding & DATA_VALUE) || (value.Encoding & DATA_VALUE_STATUS_CODE && value.Status != StatusCode::Good))
+          {
+            continue;
+          }
+          double number = 0;
+          if (AllAttributes[attribute] == AttributeID::NODE_CLASS && ToDouble(value.Value, number))
+          {
+            nodeClass = static_cast<NodeClass>(static_cast<uint32_t>(number));
+          }
+          ++count;
+          bytes += MapNodeOverhead + sizeof(AttributeID) + sizeof(DataValue) - sizeof(Variant) + EstimateSize(value.Value);
+        }
+
+        NodeClassMemory& memory = result[nodeClass];
+        ++memory.Nodes;
+        memory.Attributes += count;
+        memory.References += nodes[i].References;
+        memory.Bytes += bytes + nodes[i].ReferenceBytes;
+      }
+    }
+    return result;
+  }
+
+}
@@ -0,0 +1,41 @@
+/// @brief Estimate of the memory taken by the address space.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <opc/ua/server.h>
+
+#include <map>
+
+namespace OpcUa
+{
+
+  struct NodeClassMemory
+  {
+    std::size_t Nodes;
+    std::size_t Attributes;
+    std::size_t References;
+    std::size_t Bytes;
+
+    NodeClassMemory()
+      : Nodes(0)
+      , Attributes(0)
+      , References(0)
+      , Bytes(0)
+    {
+    }
+  };
+
+  // Walks every node reachable from root by forward references and sums what the
+  // in-memory address space keeps for it: a map entry per attribute with its DataValue
+  // and a ReferenceDescription per reference, including string payloads.
+  std::map<NodeClass, NodeClassMemory> CollectNodeMemory(Remote::Server::SharedPtr server, const NodeID& root, std::size_t batchSize = 1000);
+
+  std::size_t EstimateSize(const Variant& value);
+
+}
@@ -18,7 +18,38 @@
 #include <opc/ua/client/client.h>
 #include <opc/ua/opcuaserver.h>
 
+#include "allocation_stats.h"
+#include "array_range.h"
+#include "history_aggregates.h"
+#include "history_log.h"
+#include "lazy_address_space.h"
+#include "memory_stats.h"
+#include "node_id_text.h"
+#include "node_registry.h"
+#include "reconnecting_server.h"
+#include "request_pipeline.h"
+#include "sampling_engine.h"
+#include "shared_value_table.h"
+#include "subtree_template.h"
+#include "update_queue.h"
+#include "variant_numeric.h"
+#include "write_buffer.h"
+#include "write_hook.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <type_traits>
+
+#include <unistd.h>
 
 namespace OpcUa
 {
@@ -65,6 +96,8 @@ namespace OpcUa
     return result;
   }
 
+  python::object ToPyNodeID(const NodeID& id);
+
   struct VariantToObjectConverter
   {
     python::object Result;
@@ -85,6 +118,54 @@ namespace OpcUa
 
       Result = ToList(values);
     }
+
+    void Visit(const std::vector<ByteString>& values)
+    {
+      Convert(values, &ToBytes);
+    }
+
+    void Visit(const std::vector<NodeID>& values)
+    {
+      Convert(values, &ToPyNodeID);
+    }
+
+    void Visit(const std::vector<LocalizedText>& values)
+    {
+      Convert(values, [](const LocalizedText& text) { return python::object(text.Text); });
+    }
+
+    void Visit(const std::vector<DateTime>& values)
+    {
+      Convert(values, [](const DateTime& time) { return python::object(time.Value); });
+    }
+
+  private:
+    // For types without a Python converter of their own.
+    template <typename T, typename Function>
+    void Convert(const std::vector<T>& values, Function function)
+    {
+      if (values.empty())
+      {
+        return;
+      }
+      if (values.size() == 1)
+      {
+        Result = function(values[0]);
+        return;
+      }
+      python::list result;
+      for (const T& value : values)
+      {
+        result.append(function(value));
+      }
+      Result = result;
+    }
+
+    static python::object ToBytes(const ByteString& value)
+    {
+      const char* data = reinterpret_cast<const char*>(value.Data.data());
+      return python::object(python::handle<>(PyBytes_FromStringAndSize(data, value.Data.size())));
+    }
   };
 
   python::object ToObject(const OpcUa::Variant& var)
@@ -98,10 +179,330 @@ namespace OpcUa
     return convertor.Result;
   }
 
+  const char* GetNumpyType(VariantType type)
+  {
+    switch (type)
+    {
+      case VariantType::BOOLEAN: return "bool";
+      case VariantType::SBYTE: return "int8";
+      case VariantType::BYTE: return "uint8";
+      case VariantType::INT16: return "int16";
+      case VariantType::UINT16: return "uint16";
+      case VariantType::INT32: return "int32";
+      case VariantType::UINT32: return "uint32";
+      case VariantType::INT64: return "int64";
+      case VariantType::UINT64: return "uint64";
+      case VariantType::FLOAT: return "float32";
+      case VariantType::DOUBLE: return "float64";
+      default: return nullptr;
+    }
+  }
+
+  python::object ImportNumpy()
+  {
+    try
+    {
+      return python::import("numpy");
+    }
+    catch (const python::error_already_set&)
+    {
+      PyErr_Clear();
+      return python::object();
+    }
+  }
+
+  // numpy array over a copy of the data, or a list when numpy is not installed.
+  template <typename T>
+  python::object ToArray(const std::vector<T>& values, const char* dtype)
+  {
+    python::object numpy = ImportNumpy();
+    if (numpy.is_none())
+    {
+      return ToList(values);
+    }
+    const char* data = reinterpret_cast<const char*>(values.data());
+    python::object bytes(python::handle<>(PyBytes_FromStringAndSize(data, values.size() * sizeof(T))));
+    return numpy.attr("frombuffer")(bytes, dtype);
+  }
+
+  // Column of a fixed number of numbers written straight into the bytes object that numpy gets,
+  // so there is no intermediate vector per column.
+  template <typename T>
+  class BytesColumn
+  {
+  public:
+    explicit BytesColumn(std::size_t size)
+      : Bytes(python::handle<>(PyBytes_FromStringAndSize(nullptr, size * sizeof(T))))
+      , Data(PyBytes_AS_STRING(Bytes.ptr()))
+      , Size(size)
+    {
+    }
+
+    void Set(std::size_t index, T value)
+    {
+      std::memcpy(Data + index * sizeof(T), &value, sizeof(T));
+    }
+
+    python::object ToArray(const char* dtype) const
+    {
+      python::object numpy = ImportNumpy();
+      if (!numpy.is_none())
+      {
+        return numpy.attr("frombuffer")(Bytes, dtype);
+      }
+      python::list result;
+      for (std::size_t i = 0; i < Size; ++i)
+      {
+        T value;
+        std::memcpy(&value, Data + i * sizeof(T), sizeof(T));
+        result.append(value);
+      }
+      return result;
+    }
+
+  private:
+    const python::object Bytes;
+    char* const Data;
+    const std::size_t Size;
+  };
+
+  // Numeric arrays become one numpy array instead of a Python object per element.
+  struct VariantToArrayConverter
+  {
+    python::object Result;
+    VariantType Type;
+
+    template <typename T>
+    void Visit(const std::vector<T>& values)
+    {
+      Convert(values, std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>());
+    }
+
+  private:
+    template <typename T>
+    void Convert(const std::vector<T>& values, std::true_type)
+    {
+      Result = ToArray(values, GetNumpyType(Type));
+    }
+
+    template <typename T>
+    void Convert(const std::vector<T>&, std::false_type)
+    {
+      // Other types go through ToObject.
+    }
+  };
+
+  python::object ToArrayObject(const Variant& var)
+  {
+    if (var.IsNul() || var.Type == VariantType::BOOLEAN || !GetNumpyType(var.Type))
+    {
+      return ToObject(var);
+    }
+    VariantToArrayConverter converter;
+    converter.Type = var.Type;
+    OpcUa::ApplyVisitor(var, converter);
+    if (var.Dimensions.size() > 1 && PyObject_HasAttrString(converter.Result.ptr(), "reshape"))
+    {
+      python::list shape;
+      for (uint32_t dimension : var.Dimensions)
+      {
+        shape.append(dimension);
+      }
+      converter.Result = converter.Result.attr("reshape")(python::tuple(shape));
+    }
+    return converter.Result;
+  }
+
+  class ScopedBuffer
+  {
+  public:
+    explicit ScopedBuffer(PyObject* object)
+      : Acquired(PyObject_GetBuffer(object, &View, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) == 0)
+    {
+      if (!Acquired)
+      {
+        PyErr_Clear();
+      }
+    }
+
+    ~ScopedBuffer()
+    {
+      if (Acquired)
+      {
+        PyBuffer_Release(&View);
+      }
+    }
+
+    ScopedBuffer(const ScopedBuffer&) = delete;
+    ScopedBuffer& operator=(const ScopedBuffer&) = delete;
+
+    Py_buffer View;
+    const bool Acquired;
+  };
+
+  template <typename T>
+  void AssignBuffer(Variant& var, VariantType type, std::vector<T>& target, const Py_buffer& view)
+  {
+    const T* data = static_cast<const T*>(view.buf);
+    target.assign(data, data + view.len / sizeof(T));
+    var.Type = type;
+  }
+
+  bool IsLittleEndian()
+  {
+    const uint16_t probe = 1;
+    return *reinterpret_cast<const uint8_t*>(&probe) == 1;
+  }
+
+  // Copies the memory of array.array, numpy arrays and other buffers into the variant in one go.
+  // Returns false for buffers of records or foreign byte order, they take the generic path.
+  bool FromBuffer(const python::object& object, Variant& var)
+  {
+    if (!PyObject_CheckBuffer(object.ptr()))
+    {
+      return false;
+    }
+    ScopedBuffer buffer(object.ptr());
+    if (!buffer.Acquired)
+    {
+      return false;
+    }
+    const Py_buffer& view = buffer.View;
+    const char* format = view.format ? view.format : "B";
+    if (*format == '@' || *format == '=' || (*format == '<' && IsLittleEndian()))
+    {
+      ++format;
+    }
+    if (format[0] == 0 || format[1] != 0)
+    {
+      return false;
+    }
+
+    const bool isSigned = std::strchr("bhilqn", format[0]) != nullptr;
+    const bool isUnsigned = std::strchr("BHILQNc", format[0]) != nullptr;
+    if (format[0] == 'd' && view.itemsize == 8)
+    {
+      AssignBuffer(var, VariantType::DOUBLE, var.Value.Double, view);
+    }
+    else if (format[0] == 'f' && view.itemsize == 4)
+    {
+      AssignBuffer(var, VariantType::FLOAT, var.Value.Float, view);
+    }
+    else if (format[0] == '?' && view.itemsize == 1)
+    {
+      const uint8_t* data = static_cast<const uint8_t*>(view.buf);
+      var.Value.Boolean.assign(data, data + view.len);
+      var.Type = VariantType::BOOLEAN;
+    }
+    else if (isSigned || isUnsigned)
+    {
+      switch (view.itemsize)
+      {
+        case 1:
+          isSigned ? AssignBuffer(var, VariantType::SBYTE, var.Value.SByte, view) : AssignBuffer(var, VariantType::BYTE, var.Value.Byte, view);
+          break;
+        case 2:
+          isSigned ? AssignBuffer(var, VariantType::INT16, var.Value.Int16, view) : AssignBuffer(var, VariantType::UINT16, var.Value.UInt16, view);
+          break;
+        case 4:
+          isSigned ? AssignBuffer(var, VariantType::INT32, var.Value.Int32, view) : AssignBuffer(var, VariantType::UINT32, var.Value.UInt32, view);
+          break;
+        case 8:
+          isSigned ? AssignBuffer(var, VariantType::INT64, var.Value.Int64, view) : AssignBuffer(var, VariantType::UINT64, var.Value.UInt64, view);
+          break;
+        default:
+          return false;
+      }
+    }
+    else
+    {
+      return false;
+    }
+
+    if (view.ndim > 1)
+    {
+      var.Dimensions.assign(view.shape, view.shape + view.ndim);
+    }
+    return true;
+  }
+
+  // bytes, bytearray and memoryviews of bytes become a ByteString; the memory is copied once, straight into it.
+  // Memoryviews of other item types are left to FromBuffer.
+  bool FromBytes(const python::object& object, Variant& var)
+  {
+    PyObject* ptr = object.ptr();
+    if (PyMemoryView_Check(ptr))
+    {
+      const char* format = PyMemoryView_GET_BUFFER(ptr)->format;
+      if (format && std::strcmp(format, "B") != 0 && std::strcmp(format, "b") != 0 && std::strcmp(format, "c") != 0)
+      {
+        return false;
+      }
+    }
+    else if (!PyBytes_Check(ptr) && !PyByteArray_Check(ptr))
+    {
+      return false;
+    }
+    Py_buffer view;
+    if (PyObject_GetBuffer(ptr, &view, PyBUF_SIMPLE) != 0)
+    {
+      python::throw_error_already_set();
+    }
+    const uint8_t* data = static_cast<const uint8_t*>(view.buf);
+    var.Value.ByteStrings.resize(1);
+    var.Value.ByteStrings[0].Data.assign(data, data + view.len);
+    var.Type = VariantType::BYTE_STRING;
+    PyBuffer_Release(&view);
+    return true;
+  }
+
+  int32_t FromPyNumber(PyObject* object, int32_t*)
+  {
+    const long value = PyLong_AsLong(object);
+    if (value == -1 && PyErr_Occurred())
+    {
+      python::throw_error_already_set();
+    }
+    if (value < std::numeric_limits<int32_t>::min() || value > std::numeric_limits<int32_t>::max())
+    {
+      PyErr_SetString(PyExc_OverflowError, "Value does not fit into Int32.");
+      python::throw_error_already_set();
+    }
+    return static_cast<int32_t>(value);
+  }
+
+  double FromPyNumber(PyObject* object, double*)
+  {
+    const double value = PyFloat_AsDouble(object);
+    if (value == -1.0 && PyErr_Occurred())
+    {
+      python::throw_error_already_set();
+    }
+    return value;
+  }
+
+  // Fills the vector of the variant directly from the list items.
+  template <typename T>
+  void AssignList(Variant& var, VariantType type, std::vector<T>& target, const python::list& list)
+  {
+    PyObject* items = list.ptr();
+    const Py_ssize_t size = PyList_GET_SIZE(items);
+    target.resize(size);
+    for (Py_ssize_t i = 0; i < size; ++i)
+    {
+      target[i] = FromPyNumber(PyList_GET_ITEM(items, i), static_cast<T*>(nullptr));
+    }
+    var.Type = type;
+  }
+
   Variant FromObject(const python::object object)
   {
     Variant var;
-    if (python::extract<std::string>(object).check())
+    if (FromBytes(object, var))
+    {
+      // Filled in place.
+    }
+    else if (python::extract<std::string>(object).check())
     {
       var = python::extract<std::string>(object)();
     }
@@ -115,11 +516,11 @@ namespace OpcUa
       {
         if (python::extract<int>(object[0]).check())
         {
-          var = FromList<int>(object);
+          AssignList(var, VariantType::INT32, var.Value.Int32, plist);
         }
         else if (python::extract<double>(object[0]).check())
         {
-          var = FromList<double>(object);
+          AssignList(var, VariantType::DOUBLE, var.Value.Double, plist);
         }
         else if (python::extract<std::string>(object[0]).check())
         {
@@ -131,6 +532,10 @@ namespace OpcUa
         }
       }
     }
+    else if (FromBuffer(object, var))
+    {
+      // Filled in place.
+    }
     else if (python::extract<int>(object).check())
     {
       var = python::extract<int>(object);
@@ -154,6 +559,13 @@ namespace OpcUa
     return var;
   }
 
+  std::string ToString(const NodeID& id)
+  {
+    std::stringstream stream;
+    stream << id;
+    return stream.str();
+  }
+
   //similar to FromObject but gives a hint to what c++ object type the python object should be converted to
   Variant FromObject2(const python::object object, VariantType vtype)
   {
@@ -292,6 +704,17 @@ namespace OpcUa
       .value("UTC_TIME", OpcUa::ObjectID::UtcTime)
       .value("LOCALE_ID", OpcUa::ObjectID::LocaleID)
       .value("STRUCTURE_ARGUMENT", OpcUa::ObjectID::StructureArgument)
+      .value("BASE_EVENT_TYPE", OpcUa::ObjectID::BaseEventType)
+      .value("EVENT_ID", OpcUa::ObjectID::EventID)
+      .value("EVENT_TYPE", OpcUa::ObjectID::EventType)
+      .value("SOURCE_NODE", OpcUa::ObjectID::SourceNode)
+      .value("SOURCE_NAME", OpcUa::ObjectID::SourceName)
+      .value("TIME", OpcUa::ObjectID::Time)
+      .value("RECEIVE_TIME", OpcUa::ObjectID::ReceiveTime)
+      .value("MESSAGE", OpcUa::ObjectID::Message)
+      .value("SEVERITY", OpcUa::ObjectID::Severity)
+      .value("SERVER", OpcUa::ObjectID::Server)
+      .value("AGGREGATE_FUNCTIONS", OpcUa::ObjectID::AggregateFunctions)
 ;
 /*
 
@@ -354,15 +777,6 @@ namespace OpcUa
       VendorServerInfoType
       ServerRedundancyType
       RedundancySupportTypeRedundancySupport
-      BaseEventType
-      EventID
-      EventType
-      SourceNode
-      SourceName
-      Time
-      ReceiveTime
-      Message
-      Severity
       SystemEventType
       DeviceFailureEventType
       BaseModelChangeEventType
@@ -386,7 +800,6 @@ namespace OpcUa
       SemanticChangeEventType
       Auditing
       SessionsDiagnosticsSummary
-      AggregateFunctions
       RefreshStartEventType
       RefreshEndEventType
       RefreshRequiredEventType
@@ -418,6 +831,144 @@ namespace OpcUa
     ;
   }
 
+  // History of the nodes historized on a server. Nodes find it through the address space they belong to.
+  // Series without a monitored item store the values written with set_value in this process only.
+  // Sampled series are fed by the local sampler, so they store writes of remote clients as well.
+  struct NodeHistory
+  {
+    HistoryLog::SharedPtr Log;
+    std::map<std::string, uint32_t> Series; // Series to its monitored item, 0 if not sampled.
+    std::map<uint32_t, std::string> Items;
+    uint32_t Subscription = 0;
+  };
+
+  std::mutex NodeHistoriesMutex;
+  std::map<const Remote::Server*, std::shared_ptr<NodeHistory>> NodeHistories;
+
+  std::shared_ptr<NodeHistory> FindHistory(const Node& node, const std::string& series)
+  {
+    std::unique_lock<std::mutex> lock(NodeHistoriesMutex);
+    auto it = NodeHistories.find(node.GetServer().get());
+    if (it == NodeHistories.end() || !it->second->Series.count(series))
+    {
+      return std::shared_ptr<NodeHistory>();
+    }
+    return it->second;
+  }
+
+  // Only numeric scalars are stored, other values are not historized.
+  void RecordHistory(const Node& node, const Variant& value)
+  {
+    double number = 0;
+    if (!ToDouble(value, number))
+    {
+      return;
+    }
+    std::shared_ptr<NodeHistory> history;
+    std::string series;
+    {
+      std::unique_lock<std::mutex> lock(NodeHistoriesMutex);
+      auto it = NodeHistories.find(node.GetServer().get());
+      if (it == NodeHistories.end())
+      {
+        return;
+      }
+      series = ToString(node.GetId());
+      auto entry = it->second->Series.find(series);
+      // Sampled series get the value from the sampler.
+      if (entry == it->second->Series.end() || entry->second)
+      {
+        return;
+      }
+      history = it->second;
+    }
+    history->Log->Append(series, HistoryRecord(CurrentDateTime().Value, number, static_cast<uint32_t>(StatusCode::Good)));
+  }
+
+  // Notification callback of the local subscription of sampled series.
+  void RecordSamples(NodeHistory& history, const std::vector<MonitoredItemNotification>& notifications)
+  {
+    std::vector<std::pair<std::string, HistoryRecord>> records;
+    {
+      std::unique_lock<std::mutex> lock(NodeHistoriesMutex);
+      for (const MonitoredItemNotification& notification : notifications)
+      {
+        const DataValue& value = notification.Value;
+        auto item = history.Items.find(notification.ItemID);
+        double number = 0;
+        if (item == history.Items.end() || !ToDouble(value.Value, number))
+        {
+          continue;
+        }
+        const int64_t timestamp = value.Encoding & DATA_VALUE_SOURCE_TIMESTAMP ? value.SourceTimestamp.Value : CurrentDateTime().Value;
+        const uint32_t status = value.Encoding & DATA_VALUE_STATUS_CODE ? static_cast<uint32_t>(value.Status) : static_cast<uint32_t>(StatusCode::Good);
+        records.push_back(std::make_pair(item->second, HistoryRecord(timestamp, number, status)));
+      }
+    }
+    for (const std::pair<std::string, HistoryRecord>& record : records)
+    {
+      history.Log->Append(record.first, record.second);
+    }
+  }
+
+  // Write-behind buffers of the connected clients, looked up by the server a node talks to.
+  std::mutex WriteBuffersMutex;
+  std::map<const Remote::Server*, std::shared_ptr<WriteBuffer>> WriteBuffers;
+
+  std::shared_ptr<WriteBuffer> FindWriteBuffer(const Node& node)
+  {
+    std::unique_lock<std::mutex> lock(WriteBuffersMutex);
+    auto it = WriteBuffers.find(node.GetServer().get());
+    return it == WriteBuffers.end() ? std::shared_ptr<WriteBuffer>() : it->second;
+  }
+
+  // Standard address spaces of servers started in lazy mode, looked up by the server a node talks to.
+  std::mutex LazyAddressSpacesMutex;
+  std::map<const Remote::Server*, std::shared_ptr<LazyAddressSpace>> LazyAddressSpaces;
+
+  std::shared_ptr<LazyAddressSpace> FindLazyAddressSpace(const Node& node)
+  {
+    std::unique_lock<std::mutex> lock(LazyAddressSpacesMutex);
+    auto it = LazyAddressSpaces.find(node.GetServer().get());
+    return it == LazyAddressSpaces.end() ? std::shared_ptr<LazyAddressSpace>() : it->second;
+  }
+
+  // Lets other threads run while the current one waits for a background thread.
+  class ScopedGILRelease
+  {
+  public:
+    ScopedGILRelease()
+      : State(PyEval_SaveThread())
+    {
+    }
+
+    ~ScopedGILRelease()
+    {
+      PyEval_RestoreThread(State);
+    }
+
+  private:
+    PyThreadState* State;
+  };
+
+  // Holds the GIL while a C++ thread calls into Python.
+  class ScopedGILAcquire
+  {
+  public:
+    ScopedGILAcquire()
+      : State(PyGILState_Ensure())
+    {
+    }
+
+    ~ScopedGILAcquire()
+    {
+      PyGILState_Release(State);
+    }
+
+  private:
+    PyGILState_STATE State;
+  };
+
   struct PyNodeID: public NodeID
   {
     using NodeID::NodeID; //should work but it does not ...
@@ -510,68 +1061,1973 @@ namespace OpcUa
   };
  
 
-  class PyNode: public Node
+  python::object ToPyNodeID(const NodeID& id)
   {
-    public:
-      PyNode(OpcUa::Remote::Server::SharedPtr srv, const NodeID& id) : Node(srv, id){}
-      PyNode (const Node& other): Node( other.GetServer(), other.GetId()) {}
-      //PyNode (const Node& other): Server(other.Server), Id(other.Id), BrowseName(other.BrowseName) {}
-      //PyNode static FromNode(const Node& other) { return PyNode(other.GetServer(), other.GetNodeId()); }
-      python::object PyGetValue() { return ToObject(Node::GetValue()); }
-      python::object PyGetName() { return ToObject(Node::GetName()); }
-      PyNodeID PyGetNodeID() { return PyNodeID(Node::GetId()); }
-      python::object PySetValue(python::object val) 
-      { 
-        OpcUa::StatusCode code = Node::SetValue(FromObject(val)); 
-        return ToObject(code); 
-      }
-      python::object PySetValue2(python::object val, VariantType hint) 
-      { 
-        Variant var = FromObject2(val, hint); 
-        OpcUa::StatusCode code = Node::SetValue(var); 
-        return ToObject(code); 
-      }
+    return python::object(PyNodeID(id));
+  }
+
+  python::object ToPyNode(const Node& node);
+  ReadParameters GetReadAttributeParameters(const std::vector<NodeID>& ids, const std::vector<AttributeID>& attributes);
+
+  // Reference types may be given as ObjectID or NodeID.
+  NodeID GetReferenceTypeID(const python::object& object)
+  {
+    python::extract<ObjectID> objectID(object);
+    if (objectID.check())
+    {
+      return NodeID(objectID());
+    }
+    python::extract<PyNodeID> id(object);
+    if (id.check())
+    {
+      return id();
+    }
+    throw std::logic_error("Expected ObjectID or NodeID of a reference type.");
+  }
+  python::object ToAttributeObject(const DataValue& value);
+
+  Variant SliceValue(const Variant& value, const ArrayRange& range, const std::string& indexRange)
+  {
+    std::vector<std::size_t> shape;
+    if (!GetRangeShape(GetDimensions(value), range, shape))
+    {
+      throw std::logic_error("Index range '" + indexRange + "' has no data in the node value (BadIndexRangeNoData).");
+    }
+    Variant slice;
+    if (!ExtractRange(value, range, slice))
+    {
+      throw std::logic_error("Index range '" + indexRange + "' does not match the node value.");
+    }
+    return slice;
+  }
+
+  class PyNode: public Node
+  {
+    public:
+      PyNode(OpcUa::Remote::Server::SharedPtr srv, const NodeID& id) : Node(srv, id){}
+      PyNode (const Node& other): Node(other) {}
+      //PyNode (const Node& other): Server(other.Server), Id(other.Id), BrowseName(other.BrowseName) {}
+      //PyNode static FromNode(const Node& other) { return PyNode(other.GetServer(), other.GetNodeId()); }
+      python::object PyGetValue()
+      {
+        Variant value;
+        {
+          ScopedGILRelease release;
+          value = Node::GetValue();
+        }
+        return ToObject(value);
+      }
+      // Only the selected elements travel when the server applies the range. Whether it did is told by the
+      // ArrayDimensions of the node, read in the same request; without them the whole value is read and sliced here.
+      python::object PyGetValueRange(const std::string& indexRange)
+      {
+        const ArrayRange range = ParseArrayRange(indexRange);
+        ReadParameters params;
+        params.TimestampsType = TimestampsToReturn::NEITHER;
+        params.AttributesToRead.resize(2);
+        params.AttributesToRead[0].Node = Node::GetId();
+        params.AttributesToRead[0].Attribute = AttributeID::VALUE;
+        params.AttributesToRead[0].IndexRange = indexRange;
+        params.AttributesToRead[1].Node = Node::GetId();
+        params.AttributesToRead[1].Attribute = AttributeID::ARRAY_DIMENSIONS;
+        std::vector<DataValue> result;
+        {
+          ScopedGILRelease release;
+          result = Node::GetServer()->Attributes()->Read(params);
+        }
+        if (result.empty() || (result[0].Encoding & DATA_VALUE_STATUS_CODE && result[0].Status != StatusCode::Good))
+        {
+          throw std::logic_error("Cannot read index range '" + indexRange + "' of the node value.");
+        }
+        const std::vector<std::size_t> dimensions = result.size() > 1 ? GetArrayDimensions(result[1].Value) : std::vector<std::size_t>();
+        if (!dimensions.empty())
+        {
+          std::vector<std::size_t> shape;
+          if (!GetRangeShape(dimensions, range, shape))
+          {
+            throw std::logic_error("Index range '" + indexRange + "' has no data in the node value (BadIndexRangeNoData).");
+          }
+          const std::vector<std::size_t> returned = GetDimensions(result[0].Value);
+          if (returned == shape)
+          {
+            return ToObject(result[0].Value);
+          }
+          if (returned == dimensions)
+          {
+            return ToObject(SliceValue(result[0].Value, range, indexRange));
+          }
+        }
+        Variant value;
+        {
+          ScopedGILRelease release;
+          value = Node::GetValue();
+        }
+        return ToObject(SliceValue(value, range, indexRange));
+      }
+      python::object PyGetValueArray()
+      {
+        Variant value;
+        {
+          ScopedGILRelease release;
+          value = Node::GetValue();
+        }
+        return ToArrayObject(value);
+      }
+      // Nodes that came from a browse already know their name.
+      python::object PyGetName() { return ToObject(BrowseName.Name.empty() ? Node::GetName() : BrowseName); }
+      StatusCode SetValueWithoutGIL(const Variant& value)
+      {
+        ScopedGILRelease release;
+        return Node::SetValue(value);
+      }
+      void SetBrowseName(const QualifiedName& name)
+      {
+        if (BrowseName.Name.empty())
+        {
+          BrowseName = name;
+        }
+      }
+      python::list PyGetChildrenDescribed() { return GetChildrenDescribed(ReferenceID::HierarchicalReferences, 0); }
+      python::list PyGetChildrenDescribed2(const python::object& referenceType) { return GetChildrenDescribed(GetReferenceTypeID(referenceType), 0); }
+      python::list PyGetChildrenDescribed3(const python::object& referenceType, unsigned nodeClasses)
+      {
+        return GetChildrenDescribed(GetReferenceTypeID(referenceType), nodeClasses);
+      }
+      PyNodeID PyGetNodeID() { return PyNodeID(Node::GetId()); }
+      python::object PySetValue(python::object val) 
+      { 
+        Variant var = FromObject(val);
+        if (std::shared_ptr<WriteBuffer> buffer = FindWriteBuffer(*this))
+        {
+          buffer->Set(Node::GetId(), var);
+          return ToObject(StatusCode::Good);
+        }
+        OpcUa::StatusCode code = SetValueWithoutGIL(var);
+        if (code == StatusCode::Good)
+        {
+          RecordHistory(*this, var);
+        }
+        return ToObject(code); 
+      }
+      python::object PySetValue2(python::object val, VariantType hint) 
+      { 
+        Variant var = FromObject2(val, hint); 
+        if (std::shared_ptr<WriteBuffer> buffer = FindWriteBuffer(*this))
+        {
+          buffer->Set(Node::GetId(), var);
+          return ToObject(StatusCode::Good);
+        }
+        OpcUa::StatusCode code = SetValueWithoutGIL(var);
+        if (code == StatusCode::Good)
+        {
+          RecordHistory(*this, var);
+        }
+        return ToObject(code); 
+      }
+      // The server overwrites the selected elements in place. When it cannot write ranges
+      // the whole value is read, patched and written back.
+      // The whole value is read, patched and written back: a server that ignores WriteValue.NumericRange
+      // and still answers Good would otherwise replace the array with the slice.
+      python::object PySetValueRange(python::object val, const std::string& indexRange)
+      {
+        const ArrayRange range = ParseArrayRange(indexRange);
+        const Variant var = FromObject(val);
+        Variant value;
+        StatusCode status = StatusCode::BadIndexRangeNoData;
+        {
+          ScopedGILRelease release;
+          if (std::shared_ptr<WriteBuffer> buffer = FindWriteBuffer(*this))
+          {
+            // Pending whole values must not overwrite the range afterwards.
+            buffer->Flush();
+          }
+          value = Node::GetValue();
+          if (ReplaceRange(value, range, var))
+          {
+            status = Node::SetValue(value);
+          }
+        }
+        if (status == StatusCode::Good)
+        {
+          RecordHistory(*this, value);
+        }
+        return ToObject(status);
+      }
+      python::dict PyGetAttributes(const python::object& attributes)
+      {
+        const std::vector<AttributeID> attributeIds = FromList<AttributeID>(attributes);
+        const ReadParameters params = GetReadAttributeParameters(std::vector<NodeID>(1, Node::GetId()), attributeIds);
+        std::vector<DataValue> values;
+        {
+          ScopedGILRelease release;
+          values = Node::GetServer()->Attributes()->Read(params);
+        }
+        python::dict result;
+        for (std::size_t i = 0; i < attributeIds.size() && i < values.size(); ++i)
+        {
+          result[attributeIds[i]] = ToAttributeObject(values[i]);
+        }
+        return result;
+      }
+      python::list PyReadHistory(int64_t start, int64_t end) { return PyReadHistory2(start, end, 0); }
+      python::list PyReadHistory2(int64_t start, int64_t end, std::size_t maxValues)
+      {
+        const std::string series = ToString(Node::GetId());
+        std::shared_ptr<NodeHistory> history = FindHistory(*this, series);
+        if (!history)
+        {
+          throw std::logic_error("Node is not historized.");
+        }
+        python::list result;
+        for (const HistoryRecord& record : history->Log->Read(series, start, end, maxValues))
+        {
+          result.append(python::make_tuple(record.Timestamp, record.Value, record.Status));
+        }
+        return result;
+      }
+      // Interval in milliseconds as in ReadProcessed, start and end in DateTime ticks as in read_history.
+      python::list PyReadProcessed(int64_t start, int64_t end, double intervalMs, AggregateType aggregate)
+      {
+        const std::string series = ToString(Node::GetId());
+        std::shared_ptr<NodeHistory> history = FindHistory(*this, series);
+        if (!history)
+        {
+          throw std::logic_error("Node is not historized.");
+        }
+        const int64_t interval = static_cast<int64_t>(std::llround(intervalMs * 10000));
+        std::vector<HistoryRecord> records;
+        {
+          ScopedGILRelease release;
+          records = ReadProcessed(*history->Log, series, start, end, interval, aggregate);
+        }
+        python::list result;
+        for (const HistoryRecord& record : records)
+        {
+          result.append(python::make_tuple(record.Timestamp, record.Value, record.Status));
+        }
+        return result;
+      }
       python::list PyGetChildren()
       {
-        python::list result;
-        for (Node n: Node::GetChildren())
-        {
-          result.append(PyNode(n));
-        }
-        return result;
+        MaterializeChildren();
+        python::list result;
+        for (Node n: Node::GetChildren())
+        {
+          result.append(ToPyNode(n));
+        }
+        return result;
+      }
+      // One Browse filtered by the server; each child comes with (node, browse_name, display_name, node_class, type_definition, reference_type).
+      python::list GetChildrenDescribed(const NodeID& referenceType, unsigned nodeClasses)
+      {
+        BrowseDescription description;
+        description.NodeToBrowse = Node::GetId();
+        description.Direction = BrowseDirection::Forward;
+        description.ReferenceTypeID = referenceType;
+        description.IncludeSubtypes = true;
+        description.NodeClasses = nodeClasses;
+        description.ResultMask = BrowseResultMask::ALL;
+        NodesQuery query;
+        query.MaxReferenciesPerNode = 0;
+        query.NodesToBrowse.push_back(description);
+
+        MaterializeChildren();
+        python::list result;
+        for (const ReferenceDescription& reference : Node::GetServer()->Views()->Browse(query))
+        {
+          python::object child = ToPyNode(Node(Node::GetServer(), reference.TargetNodeID, reference.BrowseName));
+          PyNode& node = python::extract<PyNode&>(child);
+          node.SetBrowseName(reference.BrowseName);
+          result.append(python::make_tuple(
+            child,
+            reference.BrowseName,
+            reference.DisplayName.Text,
+            reference.TargetNodeClass,
+            PyNodeID(reference.TargetNodeTypeDefinition),
+            PyNodeID(reference.ReferenceTypeID)));
+        }
+        return result;
+      }
+      python::object PyGetChild(python::object path) 
+      {
+        const std::vector<std::string> names = FromList<std::string>(path);
+        if (std::shared_ptr<LazyAddressSpace> lazy = FindLazyAddressSpace(*this))
+        {
+          // Standard nodes below each step are added before the step is looked up.
+          Node n = *this;
+          for (const std::string& name : names)
+          {
+            lazy->MaterializeChildren(n.GetId());
+            n = n.GetChild(name);
+          }
+          return ToPyNode(n);
+        }
+        Node n = Node::GetChild(names);
+        return ToPyNode(n);
+      }
+      void MaterializeChildren()
+      {
+        if (std::shared_ptr<LazyAddressSpace> lazy = FindLazyAddressSpace(*this))
+        {
+          lazy->MaterializeChildren(Node::GetId());
+        }
+      }
+      python::object PyAddFolder(std::string browsename) { return ToPyNode(Node::AddFolder(browsename)); }
+      python::object PyAddFolder2(std::string nodeid, std::string browsename) { return ToPyNode(Node::AddFolder(nodeid, browsename)); }
+      python::object PyAddVariable(std::string browsename, python::object val) { return ToPyNode(Node::AddVariable(browsename, FromObject(val))); }
+      python::object PyAddVariable2(std::string nodeid, std::string browsename, python::object val) { return ToPyNode(Node::AddVariable(nodeid, browsename, FromObject(val))); }
+      python::object PyAddProperty(std::string browsename, python::object val) { return ToPyNode(Node::AddProperty(browsename, FromObject(val))); }
+      python::object PyAddProperty2(std::string nodeid, std::string browsename, python::object val) { return ToPyNode(Node::AddProperty(nodeid, browsename, FromObject(val))); }
+  };
+
+  // Python wrappers handed out for the nodes of one client or server, looked up by NodeID.
+  // Only weak references are kept, so a wrapper lives as long as Python code holds it.
+  // Used with the GIL held only.
+  class PyNodeCache
+  {
+  public:
+    python::object Get(const Node& node)
+    {
+      const NodeID& key = node.GetId();
+      std::map<NodeID, python::object>::iterator it = Wrappers.find(key);
+      if (it != Wrappers.end())
+      {
+        PyObject* wrapper = PyWeakref_GetObject(it->second.ptr());
+        if (wrapper != Py_None)
+        {
+          return python::object(python::handle<>(python::borrowed(wrapper)));
+        }
+      }
+
+      python::object wrapper = python::object(PyNode(node));
+      python::object reference(python::handle<>(PyWeakref_NewRef(wrapper.ptr(), nullptr)));
+      if (it != Wrappers.end())
+      {
+        it->second = reference;
+      }
+      else
+      {
+        Wrappers.insert(std::make_pair(key, reference));
+        if (Wrappers.size() >= PurgeSize)
+        {
+          Purge();
+        }
+      }
+      return wrapper;
+    }
+
+    void Clear()
+    {
+      Wrappers.clear();
+      PurgeSize = 1024;
+    }
+
+  private:
+    // Drops entries of released wrappers; runs again once the cache doubles.
+    void Purge()
+    {
+      for (std::map<NodeID, python::object>::iterator it = Wrappers.begin(); it != Wrappers.end();)
+      {
+        if (PyWeakref_GetObject(it->second.ptr()) == Py_None)
+        {
+          it = Wrappers.erase(it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+      PurgeSize = std::max<std::size_t>(1024, Wrappers.size() * 2);
+    }
+
+  private:
+    std::map<NodeID, python::object> Wrappers;
+    std::size_t PurgeSize = 1024;
+  };
+
+  // Caches of the connected clients and started servers, looked up by the server a node talks to.
+  // Each client or server owns its cache and removes it here when it disconnects or stops,
+  // so a new server at the same address never sees old entries. Used with the GIL held only.
+  std::map<const Remote::Server*, PyNodeCache*> NodeCaches;
+
+  void RegisterNodeCache(const Remote::Server* server, PyNodeCache& cache)
+  {
+    NodeCaches[server] = &cache;
+  }
+
+  void ForgetNodeCache(PyNodeCache& cache)
+  {
+    for (auto it = NodeCaches.begin(); it != NodeCaches.end();)
+    {
+      it = it->second == &cache ? NodeCaches.erase(it) : std::next(it);
+    }
+    cache.Clear();
+  }
+
+  // Nodes of servers without a cache, e.g. of a stopped server, get a new wrapper each time.
+  python::object ToPyNode(const Node& node)
+  {
+    auto it = NodeCaches.find(node.GetServer().get());
+    return it == NodeCaches.end() ? python::object(PyNode(node)) : it->second->Get(node);
+  }
+
+  // Handle of a node registered with register_local_nodes, read and written through its alias.
+  class PyRegisteredNode
+  {
+  public:
+    PyRegisteredNode(const Node& node, std::shared_ptr<NodeRegistry> registry, uint64_t alias)
+      : Target(node)
+      , Registry(registry)
+      , Alias(alias)
+    {
+    }
+
+    NodeID GetId() const { return Registry->GetNode(Alias); }
+    PyNodeID PyGetNodeID() const { return PyNodeID(GetId()); }
+    uint64_t GetAlias() const { return Alias; }
+
+    python::object PyGetValue() const
+    {
+      const ReadParameters params = Registry->GetReadParameters(std::vector<uint64_t>(1, Alias));
+      std::vector<DataValue> result;
+      {
+        ScopedGILRelease release;
+        result = Target.GetServer()->Attributes()->Read(params);
+      }
+      return result.empty() ? python::object() : ToObject(result[0].Value);
+    }
+
+    python::object PySetValue(const python::object& val)
+    {
+      const Variant var = FromObject(val);
+      if (std::shared_ptr<WriteBuffer> buffer = FindWriteBuffer(Target))
+      {
+        buffer->Set(GetId(), var);
+        return ToObject(StatusCode::Good);
+      }
+      const std::vector<WriteValue> request = Registry->GetWriteValues(std::vector<uint64_t>(1, Alias), std::vector<Variant>(1, var));
+      StatusCode status = StatusCode::BadNodeIdUnknown;
+      {
+        ScopedGILRelease release;
+        const std::vector<StatusCode> statuses = Target.GetServer()->Attributes()->Write(request);
+        status = statuses.empty() ? status : statuses[0];
+      }
+      if (status == StatusCode::Good)
+      {
+        RecordHistory(Target, var);
+      }
+      return ToObject(status);
+    }
+
+    const std::shared_ptr<NodeRegistry>& GetRegistry() const { return Registry; }
+
+  private:
+    Node Target;
+    std::shared_ptr<NodeRegistry> Registry;
+    uint64_t Alias;
+  };
+
+  NodeID GetNodeID(const python::object& object)
+  {
+    python::extract<const PyRegisteredNode&> registered(object);
+    if (registered.check())
+    {
+      return registered().GetId();
+    }
+    python::extract<PyNode> node(object);
+    if (node.check())
+    {
+      return node().GetId();
+    }
+    python::extract<PyNodeID> id(object);
+    if (id.check())
+    {
+      return id();
+    }
+    python::extract<ObjectID> objectID(object);
+    if (objectID.check())
+    {
+      return NodeID(objectID());
+    }
+    throw std::logic_error("Expected Node, NodeID, ObjectID or a registered node.");
+  }
+
+  // NodeIDs kept in one C++ vector instead of a list of Python objects.
+  struct PyNodeIDArray
+  {
+    std::vector<NodeID> Ids;
+
+    std::size_t Size() const { return Ids.size(); }
+    PyNodeID Get(long index) const
+    {
+      const long size = Ids.size();
+      if (index < -size || index >= size)
+      {
+        throw std::out_of_range("NodeID index out of range.");
+      }
+      return PyNodeID(Ids[index < 0 ? index + size : index]);
+    }
+  };
+
+  std::vector<NodeID> GetNodeIDs(const python::object& nodes)
+  {
+    python::extract<const PyNodeIDArray&> array(nodes);
+    if (array.check())
+    {
+      return array().Ids;
+    }
+    const std::size_t count = python::len(nodes);
+    std::vector<NodeID> result(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      result[i] = GetNodeID(nodes[i]);
+    }
+    return result;
+  }
+
+  PyNodeIDArray ParseNodeIDs(const python::object& texts)
+  {
+    PyNodeIDArray result;
+    result.Ids = NodeIDParser().Parse(FromList<std::string>(texts));
+    return result;
+  }
+
+  PyNodeIDArray ParseNodeIDs2(const python::object& texts, const python::object& namespaceURIs)
+  {
+    PyNodeIDArray result;
+    result.Ids = NodeIDParser(FromList<std::string>(namespaceURIs)).Parse(FromList<std::string>(texts));
+    return result;
+  }
+
+  python::list FormatNodeIDList(const python::object& nodes)
+  {
+    python::list result;
+    for (const NodeID& id : GetNodeIDs(nodes))
+    {
+      result.append(FormatNodeID(id));
+    }
+    return result;
+  }
+
+  // None unless the module was built with OPCUA_COUNT_ALLOCATIONS.
+  python::object PyGetAllocationStats()
+  {
+    if (!IsAllocationCountingEnabled())
+    {
+      return python::object();
+    }
+    const AllocationStats stats = GetAllocationStats();
+    python::dict result;
+    result["allocations"] = stats.Allocations;
+    result["bytes"] = stats.Bytes;
+    return result;
+  }
+
+  // Writes scalar values of one numeric type one after another, so they can be handed to numpy as is.
+  struct ScalarColumnWriter
+  {
+    std::string Data;
+    VariantType Type;
+    bool Failed;
+
+    ScalarColumnWriter()
+      : Type(VariantType::NUL)
+      , Failed(false)
+    {
+    }
+
+    void Write(const Variant& var)
+    {
+      if (Failed || var.IsNul() || (Type != VariantType::NUL && var.Type != Type))
+      {
+        Failed = true;
+        return;
+      }
+      Type = var.Type;
+      OpcUa::ApplyVisitor(var, *this);
+    }
+
+    template <typename T>
+    void Visit(const std::vector<T>& values)
+    {
+      Append(values, std::is_arithmetic<T>());
+    }
+
+  private:
+    template <typename T>
+    void Append(const std::vector<T>& values, std::true_type)
+    {
+      if (values.size() != 1)
+      {
+        Failed = true;
+        return;
+      }
+      const T value = values[0];
+      Data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    void Append(const std::vector<T>&, std::false_type)
+    {
+      Failed = true;
+    }
+  };
+
+  // Reads values of the nodes in one request and returns them as parallel columns,
+  // without building DataValue object per node.
+  ReadParameters GetReadValueParameters(const python::object& nodes)
+  {
+    OpcUa::ReadParameters params;
+    params.TimestampsType = TimestampsToReturn::BOTH;
+    std::vector<NodeID> ids = GetNodeIDs(nodes);
+    params.AttributesToRead.resize(ids.size());
+    for (std::size_t i = 0; i < ids.size(); ++i)
+    {
+      params.AttributesToRead[i].Node = std::move(ids[i]);
+      params.AttributesToRead[i].Attribute = AttributeID::VALUE;
+    }
+    return params;
+  }
+
+  python::dict ToValueColumns(const std::vector<DataValue>& data)
+  {
+    BytesColumn<uint32_t> statuses(data.size());
+    BytesColumn<int64_t> sourceTimestamps(data.size());
+    BytesColumn<int64_t> serverTimestamps(data.size());
+    ScalarColumnWriter writer;
+    writer.Data.reserve(data.size() * sizeof(int64_t));
+    for (std::size_t i = 0; i < data.size(); ++i)
+    {
+      const DataValue& value = data[i];
+      statuses.Set(i, value.Encoding & DATA_VALUE_STATUS_CODE ? static_cast<uint32_t>(value.Status) : 0);
+      sourceTimestamps.Set(i, value.Encoding & DATA_VALUE_SOURCE_TIMESTAMP ? value.SourceTimestamp.Value : 0);
+      serverTimestamps.Set(i, value.Encoding & DATA_VALUE_SERVER_TIMESTAMP ? value.ServerTimestamp.Value : 0);
+      writer.Write(value.Value);
+    }
+
+    python::dict result;
+    const char* dtype = GetNumpyType(writer.Type);
+    python::object numpy = ImportNumpy();
+    if (!writer.Failed && dtype && !numpy.is_none())
+    {
+      python::object bytes(python::handle<>(PyBytes_FromStringAndSize(writer.Data.data(), writer.Data.size())));
+      result["value"] = numpy.attr("frombuffer")(bytes, dtype);
+    }
+    else
+    {
+      python::list values;
+      for (const DataValue& value : data)
+      {
+        values.append(ToObject(value.Value));
+      }
+      result["value"] = values;
+    }
+    result["status"] = statuses.ToArray("uint32");
+    result["source_timestamp"] = sourceTimestamps.ToArray("int64");
+    result["server_timestamp"] = serverTimestamps.ToArray("int64");
+    return result;
+  }
+
+  // Reads through the worker pipeline when there is one; other Python threads run meanwhile.
+  std::vector<DataValue> ReadData(Remote::Server::SharedPtr server, std::shared_ptr<RequestPipeline> pipeline, const ReadParameters& params)
+  {
+    ScopedGILRelease release;
+    return pipeline ? pipeline->Read(params) : server->Attributes()->Read(params);
+  }
+
+  python::dict ReadValueColumns(Remote::Server::SharedPtr server, std::shared_ptr<RequestPipeline> pipeline, const python::object& nodes)
+  {
+    return ToValueColumns(ReadData(server, pipeline, GetReadValueParameters(nodes)));
+  }
+
+  // Every attribute of every node in one request, node by node.
+  ReadParameters GetReadAttributeParameters(const std::vector<NodeID>& ids, const std::vector<AttributeID>& attributes)
+  {
+    ReadParameters params;
+    params.TimestampsType = TimestampsToReturn::NEITHER;
+    params.AttributesToRead.resize(ids.size() * attributes.size());
+    std::size_t index = 0;
+    for (const NodeID& id : ids)
+    {
+      for (AttributeID attribute : attributes)
+      {
+        params.AttributesToRead[index].Node = id;
+        params.AttributesToRead[index].Attribute = attribute;
+        ++index;
+      }
+    }
+    return params;
+  }
+
+  python::object ToAttributeObject(const DataValue& value)
+  {
+    if (!(value.Encoding & DATA_VALUE) || (value.Encoding & DATA_VALUE_STATUS_CODE && value.Status != StatusCode::Good))
+    {
+      return python::object();
+    }
+    return ToObject(value.Value);
+  }
+
+  // A list of values per attribute, one per node; None where the attribute could not be read.
+  python::dict ToAttributeColumns(const std::vector<DataValue>& data, std::size_t nodeCount, const std::vector<AttributeID>& attributes)
+  {
+    if (data.size() != nodeCount * attributes.size())
+    {
+      throw std::logic_error("Server returned unexpected number of attributes.");
+    }
+    python::dict result;
+    for (std::size_t attribute = 0; attribute < attributes.size(); ++attribute)
+    {
+      python::list values;
+      for (std::size_t node = 0; node < nodeCount; ++node)
+      {
+        values.append(ToAttributeObject(data[node * attributes.size() + attribute]));
+      }
+      result[attributes[attribute]] = values;
+    }
+    return result;
+  }
+
+  python::dict ReadAttributeColumns(Remote::Server::SharedPtr server, std::shared_ptr<RequestPipeline> pipeline, const python::object& nodes, const python::object& attributes)
+  {
+    const std::vector<NodeID> ids = GetNodeIDs(nodes);
+    const std::vector<AttributeID> attributeIds = FromList<AttributeID>(attributes);
+    return ToAttributeColumns(ReadData(server, pipeline, GetReadAttributeParameters(ids, attributeIds)), ids.size(), attributeIds);
+  }
+
+  // Paths start at the root folder and follow hierarchical references.
+  // A path is a list of browse names, e.g. ["0:Objects", "3:Boiler"], or the same names joined by '/'.
+  BrowsePath GetBrowsePath(const python::object& path)
+  {
+    std::vector<std::string> names;
+    python::extract<std::string> text(path);
+    if (text.check())
+    {
+      std::istringstream stream(text());
+      std::string name;
+      while (std::getline(stream, name, '/'))
+      {
+        names.push_back(name);
+      }
+    }
+    else
+    {
+      names = FromList<std::string>(path);
+    }
+    BrowsePath result;
+    result.StartingNode = NodeID(ObjectID::RootFolder);
+    result.Path.Elements.resize(names.size());
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+      RelativePathElement& element = result.Path.Elements[i];
+      element.ReferenceTypeID = NodeID(ReferenceID::HierarchicalReferences);
+      element.IncludeSubtypes = true;
+      element.TargetName = QualifiedName::ParseFromString(names[i]);
+    }
+    return result;
+  }
+
+  // Without a pipeline the paths still go in chunks, so that one message does not grow without bound.
+  const std::size_t MaxPathsPerRequest = 1000;
+
+  std::vector<BrowsePathResult> TranslateBrowsePaths(Remote::Server::SharedPtr server, std::shared_ptr<RequestPipeline> pipeline, const std::vector<BrowsePath>& paths)
+  {
+    ScopedGILRelease release;
+    if (pipeline)
+    {
+      return pipeline->TranslateBrowsePaths(paths);
+    }
+    std::vector<BrowsePathResult> result;
+    result.reserve(paths.size());
+    for (std::size_t begin = 0; begin < paths.size(); begin += MaxPathsPerRequest)
+    {
+      TranslateBrowsePathsParameters params;
+      params.BrowsePaths.assign(paths.begin() + begin, paths.begin() + std::min(begin + MaxPathsPerRequest, paths.size()));
+      const std::vector<BrowsePathResult> part = server->Views()->TranslateBrowsePathsToNodeIds(params);
+      result.insert(result.end(), part.begin(), part.end());
+    }
+    return result;
+  }
+
+  // One (node, status) per path in request order, node is None when the path does not resolve.
+  python::list TranslatePaths(Remote::Server::SharedPtr server, std::shared_ptr<RequestPipeline> pipeline, const python::object& paths, LazyAddressSpace* lazy = nullptr)
+  {
+    const std::size_t count = python::len(paths);
+    std::vector<BrowsePath> browsePaths(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      browsePaths[i] = GetBrowsePath(paths[i]);
+      if (lazy)
+      {
+        std::vector<QualifiedName> names;
+        for (const RelativePathElement& element : browsePaths[i].Path.Elements)
+        {
+          names.push_back(element.TargetName);
+        }
+        lazy->MaterializePath(names);
+      }
+    }
+    const std::vector<BrowsePathResult> results = TranslateBrowsePaths(server, pipeline, browsePaths);
+
+    python::list result;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      StatusCode status = i < results.size() ? results[i].Status : StatusCode::BadNoMatch;
+      const BrowsePathTarget* target = nullptr;
+      if (status == StatusCode::Good)
+      {
+        for (const BrowsePathTarget& candidate : results[i].Targets)
+        {
+          // Targets on other servers leave part of the path unresolved.
+          if (candidate.RemainingPathIndex == std::numeric_limits<uint32_t>::max())
+          {
+            target = &candidate;
+            break;
+          }
+        }
+        status = target ? status : StatusCode::BadNoMatch;
+      }
+      python::object node = target ? ToPyNode(Node(server, target->Node)) : python::object();
+      result.append(python::make_tuple(node, static_cast<uint32_t>(status)));
+    }
+    return result;
+  }
+
+  // Nodes are resolved once here: a node that does not exist fails the call and nothing is registered.
+  python::list RegisterNodes(Remote::Server::SharedPtr server, std::shared_ptr<RequestPipeline> pipeline, std::shared_ptr<NodeRegistry> registry, const python::object& nodes)
+  {
+    const std::vector<NodeID> ids = GetNodeIDs(nodes);
+    const std::vector<DataValue> values = ReadData(server, pipeline, GetReadAttributeParameters(ids, std::vector<AttributeID>(1, AttributeID::NODE_ID)));
+    for (std::size_t i = 0; i < ids.size(); ++i)
+    {
+      if (i >= values.size() || (values[i].Encoding & DATA_VALUE_STATUS_CODE && values[i].Status != StatusCode::Good))
+      {
+        throw std::logic_error("Cannot register unknown node " + ToString(ids[i]) + ".");
+      }
+    }
+    const std::vector<uint64_t> aliases = registry->Add(ids);
+    python::list result;
+    for (std::size_t i = 0; i < ids.size(); ++i)
+    {
+      result.append(PyRegisteredNode(Node(server, ids[i]), registry, aliases[i]));
+    }
+    return result;
+  }
+
+  void UnregisterNodes(std::shared_ptr<NodeRegistry> registry, const python::object& handles)
+  {
+    std::vector<uint64_t> aliases;
+    for (const PyRegisteredNode& handle : FromList<PyRegisteredNode>(handles))
+    {
+      if (handle.GetRegistry() != registry)
+      {
+        throw std::logic_error("Node was registered with another connection.");
+      }
+      aliases.push_back(handle.GetAlias());
+    }
+    registry->Remove(aliases);
+  }
+
+  // Keeps a Python callable for a C++ thread; it is released under the GIL whichever thread drops the last copy.
+  std::shared_ptr<python::object> ShareCallable(const python::object& callable)
+  {
+#if PY_VERSION_HEX < 0x03070000
+    PyEval_InitThreads();
+#endif
+    return std::shared_ptr<python::object>(new python::object(callable), [](python::object* obj)
+      {
+        PyGILState_STATE state = PyGILState_Ensure();
+        delete obj;
+        PyGILState_Release(state);
+      });
+  }
+
+  // Python callable invoked from the write-behind thread with a list of (node_id, status, message).
+  struct PyWriteErrorCallback
+  {
+    std::shared_ptr<python::object> Callable;
+
+    void operator()(const std::vector<WriteError>& errors) const
+    {
+      ScopedGILAcquire gil;
+      try
+      {
+        (*Callable)(ToWriteErrorList(errors));
+      }
+      catch (const python::error_already_set&)
+      {
+        // The write-behind thread counts it as a callback error and keeps the errors queued.
+        PyErr_Clear();
+        throw std::runtime_error("Write error callback raised an exception.");
+      }
+    }
+
+    static python::list ToWriteErrorList(const std::vector<WriteError>& errors)
+    {
+      python::list result;
+      for (const WriteError& error : errors)
+      {
+        result.append(python::make_tuple(PyNodeID(error.Node), static_cast<uint32_t>(error.Status), error.Message));
+      }
+      return result;
+    }
+  };
+
+  // Python callable invoked from a write hook thread with a list of (node, value, previous, source_timestamp).
+  struct PyWriteHookCallback
+  {
+    Remote::Server::SharedPtr Server;
+    std::shared_ptr<python::object> Callable;
+
+    void operator()(const std::vector<WriteEvent>& events) const
+    {
+      ScopedGILAcquire gil;
+      try
+      {
+        python::list batch;
+        for (const WriteEvent& event : events)
+        {
+          batch.append(python::make_tuple(ToPyNode(Node(Server, event.Node)), ToObject(event.Value), ToObject(event.Previous), event.SourceTimestamp));
+        }
+        (*Callable)(batch);
+      }
+      catch (const python::error_already_set&)
+      {
+        // The hook thread counts it as a callback error and goes on with the next batch.
+        PyErr_Clear();
+        throw std::runtime_error("Write hook callback raised an exception.");
+      }
+    }
+  };
+
+  class PyClient: public RemoteClient
+  {
+    public:
+      ~PyClient()
+      {
+        PyDisableWriteBehind();
+        ForgetNodeCache(Nodes);
+      }
+      void PyConnect()
+      {
+        if (Server)
+        {
+          // The write-behind thread, pipeline and node cache belong to the old connection.
+          PyDisconnect();
+        }
+        Remote::SessionParameters session;
+        session.ClientDescription.URI = Uri;
+        session.ClientDescription.ProductURI = Uri;
+        session.ClientDescription.Name.Text = SessionName;
+        session.ClientDescription.Type = ApplicationType::CLIENT;
+        session.SessionName = SessionName;
+        session.EndpointURL = Endpoint;
+        session.Timeout = 1200000;
+        std::shared_ptr<ReconnectingServer> connection = std::make_shared<ReconnectingServer>(Endpoint, session);
+        {
+          ScopedGILRelease release;
+          connection->Connect();
+        }
+        if (AutoReconnect)
+        {
+          connection->EnableAutoReconnect(Policy);
+        }
+        Connection = connection;
+        Server = connection;
+        RegisterNodeCache(Server.get(), Nodes);
+      }
+      void PyDisconnect()
+      {
+        PyDisableWriteBehind();
+        ForgetNodeCache(Nodes);
+        Pipeline.reset();
+        {
+          ScopedGILRelease release;
+          RemoteClient::Disconnect();
+        }
+        Connection.reset();
+      }
+      void PyEnableAutoReconnect()
+      {
+        PyEnableAutoReconnect2(1000, 100, 10000);
+      }
+      void PyEnableAutoReconnect2(unsigned checkIntervalMs, unsigned minDelayMs, unsigned maxDelayMs)
+      {
+        Policy.CheckIntervalMs = checkIntervalMs;
+        Policy.MinDelayMs = minDelayMs;
+        Policy.MaxDelayMs = maxDelayMs;
+        AutoReconnect = true;
+        if (Connection)
+        {
+          ScopedGILRelease release;
+          Connection->EnableAutoReconnect(Policy);
+        }
+      }
+      void PyDisableAutoReconnect()
+      {
+        AutoReconnect = false;
+        if (Connection)
+        {
+          ScopedGILRelease release;
+          Connection->DisableAutoReconnect();
+        }
+      }
+      bool PyReconnect()
+      {
+        const std::shared_ptr<ReconnectingServer> connection = GetConnection();
+        ScopedGILRelease release;
+        return connection->Reconnect();
+      }
+      python::dict PyGetConnectionStats()
+      {
+        const ConnectionStats stats = GetConnection()->GetStats();
+        python::dict result;
+        result["connected"] = stats.Connected;
+        result["reconnects"] = stats.Reconnects;
+        result["sessions_reused"] = stats.SessionsReused;
+        result["failed_attempts"] = stats.FailedAttempts;
+        result["last_reconnect_ms"] = stats.LastReconnectMs;
+        result["max_reconnect_ms"] = stats.MaxReconnectMs;
+        result["avg_reconnect_ms"] = stats.Reconnects ? stats.TotalReconnectMs / stats.Reconnects : 0.0;
+        return result;
+      }
+      python::list PyGetEndpoints()
+      {
+        const std::shared_ptr<ReconnectingServer> connection = GetConnection();
+        std::vector<EndpointDescription> endpoints;
+        {
+          ScopedGILRelease release;
+          endpoints = connection->GetEndpoints();
+        }
+        python::list result;
+        for (const EndpointDescription& endpoint : endpoints)
+        {
+          result.append(python::make_tuple(endpoint.EndpointURL, endpoint.SecurityPolicyURI, static_cast<uint32_t>(endpoint.SecurityMode), endpoint.ServerDescription.URI));
+        }
+        return result;
+      }
+      python::list PyFindServers()
+      {
+        const std::shared_ptr<ReconnectingServer> connection = GetConnection();
+        std::vector<ApplicationDescription> servers;
+        {
+          ScopedGILRelease release;
+          servers = connection->FindServers();
+        }
+        python::list result;
+        for (const ApplicationDescription& server : servers)
+        {
+          python::list urls;
+          for (const std::string& url : server.DiscoveryURLs)
+          {
+            urls.append(url);
+          }
+          result.append(python::make_tuple(server.URI, server.ProductURI, server.Name.Text, static_cast<uint32_t>(server.Type), urls));
+        }
+        return result;
+      }
+      void PySetRequestChunkSize(std::size_t chunkSize)
+      {
+        if (!Server)
+        {
+          throw std::logic_error("Client is not connected.");
+        }
+        // A chunk size of 0 sends every call as one request again.
+        // Calls already running keep their own reference to the previous pipeline.
+        // The connection is not known to be safe for concurrent calls, so chunks go one after another.
+        Pipeline = chunkSize ? std::make_shared<RequestPipeline>(Server, 1, chunkSize) : std::shared_ptr<RequestPipeline>();
+      }
+      std::size_t PyGetRequestChunkSize() { return Pipeline ? Pipeline->GetChunkSize() : 0; }
+      python::dict PyGetRequestStats()
+      {
+        python::dict result;
+        if (Pipeline)
+        {
+          const RequestPipelineStats stats = Pipeline->GetStats();
+          result["requests"] = stats.Requests;
+          result["chunks"] = stats.Chunks;
+          result["max_in_flight"] = stats.MaxInFlight;
+        }
+        return result;
+      }
+      python::list PyWriteValues(const python::object& nodes, const python::object& values)
+      {
+        const std::vector<NodeID> ids = GetNodeIDs(nodes);
+        const std::size_t count = ids.size();
+        if (static_cast<std::size_t>(python::len(values)) != count)
+        {
+          throw std::logic_error("Number of nodes and values differ.");
+        }
+        std::vector<WriteValue> request(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+          request[i].Node = ids[i];
+          request[i].Attribute = AttributeID::VALUE;
+          request[i].Data.Value = FromObject(values[i]);
+          request[i].Data.Encoding = DATA_VALUE;
+        }
+        std::vector<StatusCode> statuses;
+        {
+          const std::shared_ptr<RequestPipeline> pipeline = Pipeline;
+          ScopedGILRelease release;
+          statuses = pipeline ? pipeline->Write(request) : Server->Attributes()->Write(request);
+        }
+        python::list result;
+        for (StatusCode status : statuses)
+        {
+          result.append(static_cast<uint32_t>(status));
+        }
+        return result;
+      }
+      void PyEnableWriteBehind(unsigned intervalMs, std::size_t maxPending)
+      {
+        EnableWriteBehind(intervalMs, maxPending, WriteBuffer::ErrorCallback());
+      }
+      void PyEnableWriteBehind2(unsigned intervalMs, std::size_t maxPending, python::object callback)
+      {
+        PyWriteErrorCallback onError;
+        onError.Callable = ShareCallable(callback);
+        EnableWriteBehind(intervalMs, maxPending, onError);
+      }
+      void PyDisableWriteBehind()
+      {
+        std::shared_ptr<WriteBuffer> buffer;
+        {
+          std::unique_lock<std::mutex> lock(WriteBuffersMutex);
+          auto it = WriteBuffers.find(Server.get());
+          if (it == WriteBuffers.end())
+          {
+            return;
+          }
+          buffer = it->second;
+          WriteBuffers.erase(it);
+        }
+        ScopedGILRelease release;
+        buffer->Stop();
+      }
+      void PyFlush()
+      {
+        if (std::shared_ptr<WriteBuffer> buffer = GetWriteBuffer())
+        {
+          ScopedGILRelease release;
+          buffer->Flush();
+        }
+      }
+      python::list PyGetWriteErrors()
+      {
+        std::shared_ptr<WriteBuffer> buffer = GetWriteBuffer();
+        return buffer ? PyWriteErrorCallback::ToWriteErrorList(buffer->TakeErrors()) : python::list();
+      }
+      python::dict PyGetWriteStats()
+      {
+        std::shared_ptr<WriteBuffer> buffer = GetWriteBuffer();
+        if (!buffer)
+        {
+          throw std::logic_error("Write-behind mode is not enabled.");
+        }
+        const WriteBufferStats stats = buffer->GetStats();
+        python::dict result;
+        result["queued"] = stats.Queued;
+        result["coalesced"] = stats.Coalesced;
+        result["written"] = stats.Written;
+        result["failed"] = stats.Failed;
+        result["requests"] = stats.Requests;
+        result["callback_errors"] = stats.CallbackErrors;
+        return result;
+      }
+      python::object PyGetRootNode() { return ToPyNode(Node(Server, OpcUa::ObjectID::RootFolder)); }
+      python::object PyGetObjectsNode() { return ToPyNode(Node(Server, OpcUa::ObjectID::ObjectsFolder)); }
+      python::object PyGetNode(PyNodeID nodeid) { return ToPyNode(RemoteClient::GetNode(nodeid)); }
+      python::dict PyReadValues(const python::object& nodes) { return ReadValueColumns(Server, Pipeline, nodes); }
+      python::list PyTranslatePaths(const python::object& paths) { return TranslatePaths(Server, Pipeline, paths); }
+      python::list PyRegisterNodes(const python::object& nodes) { return RegisterNodes(Server, Pipeline, Registry, nodes); }
+      void PyUnregisterNodes(const python::object& handles) { UnregisterNodes(Registry, handles); }
+      python::dict PyReadAttributes(const python::object& nodes, const python::object& attributes)
+      {
+        return ReadAttributeColumns(Server, Pipeline, nodes, attributes);
+      }
+      //PyNode PyGetNodeFromPath(const python::object& path) { return Client::Client::GetNodeFromPath(FromList<std::string>(path)); }
+
+    private:
+      void EnableWriteBehind(unsigned intervalMs, std::size_t maxPending, const WriteBuffer::ErrorCallback& onError)
+      {
+        if (!Server)
+        {
+          throw std::logic_error("Client is not connected.");
+        }
+        PyDisableWriteBehind();
+        std::shared_ptr<WriteBuffer> buffer = std::make_shared<WriteBuffer>(Server, intervalMs, maxPending, onError);
+        std::unique_lock<std::mutex> lock(WriteBuffersMutex);
+        WriteBuffers[Server.get()] = buffer;
+      }
+
+      std::shared_ptr<WriteBuffer> GetWriteBuffer()
+      {
+        std::unique_lock<std::mutex> lock(WriteBuffersMutex);
+        auto it = WriteBuffers.find(Server.get());
+        return it == WriteBuffers.end() ? std::shared_ptr<WriteBuffer>() : it->second;
+      }
+
+      std::shared_ptr<ReconnectingServer> GetConnection() const
+      {
+        if (!Connection)
+        {
+          throw std::logic_error("Client is not connected.");
+        }
+        return Connection;
+      }
+
+    private:
+      std::shared_ptr<RequestPipeline> Pipeline;
+      std::shared_ptr<NodeRegistry> Registry = std::make_shared<NodeRegistry>();
+      // Same object as Server, nodes keep working through it after a reconnect.
+      std::shared_ptr<ReconnectingServer> Connection;
+      ReconnectPolicy Policy;
+      PyNodeCache Nodes;
+      bool AutoReconnect = false;
+  };
+
+
+
+  // Values are stored with the type FromObject would give them.
+  SharedValue ToSharedValue(const python::object& value, int64_t timestamp)
+  {
+    if (PyBool_Check(value.ptr()))
+    {
+      return SharedValue::FromBoolean(value.ptr() == Py_True, timestamp);
+    }
+    if (python::extract<int>(value).check())
+    {
+      return SharedValue::FromInt32(python::extract<int>(value)(), timestamp);
+    }
+    if (PyLong_Check(value.ptr()))
+    {
+      return SharedValue::FromInt64(python::extract<int64_t>(value)(), timestamp);
+    }
+    if (python::extract<double>(value).check())
+    {
+      return SharedValue::FromDouble(python::extract<double>(value)(), timestamp);
+    }
+    throw std::logic_error("Shared value table holds only bool, int and float values.");
+  }
+
+  // Opened by name in producer processes, they do not need a server.
+  class PySharedValueTable
+  {
+    public:
+      PySharedValueTable(const std::string& name, std::size_t slotCount)
+        : Table(std::make_shared<SharedValueTable>(name, slotCount))
+      {
+      }
+      explicit PySharedValueTable(const std::string& name)
+        : PySharedValueTable(name, 0)
+      {
+      }
+      void Write(std::size_t slot, const python::object& value) { Write2(slot, value, 0); }
+      void Write2(std::size_t slot, const python::object& value, int64_t timestamp)
+      {
+        Table->Write(slot, ToSharedValue(value, timestamp));
       }
-      PyNode PyGetChild(python::object path) 
+      python::object Read(std::size_t slot) const
       {
-        Node n = Node::GetChild(FromList<std::string>(path));
-        return PyNode(n);
+        SharedValue value;
+        uint32_t sequence = 0;
+        if (!Table->Read(slot, value, sequence))
+        {
+          throw std::logic_error("Slot is locked by a writer.");
+        }
+        return ToObject(value.ToVariant());
       }
-      PyNode PyAddFolder(std::string browsename) { return PyNode(Node::AddFolder(browsename)); }
-      PyNode PyAddFolder2(std::string nodeid, std::string browsename) { return PyNode(Node::AddFolder(nodeid, browsename)); }
-      PyNode PyAddVariable(std::string browsename, python::object val) { return PyNode(Node::AddVariable(browsename, FromObject(val))); }
-      PyNode PyAddVariable2(std::string nodeid, std::string browsename, python::object val) { return PyNode(Node::AddVariable(nodeid, browsename, FromObject(val))); }
-      PyNode PyAddProperty(std::string browsename, python::object val) { return PyNode(Node::AddProperty(browsename, FromObject(val))); }
-      PyNode PyAddProperty2(std::string nodeid, std::string browsename, python::object val) { return PyNode(Node::AddProperty(nodeid, browsename, FromObject(val))); }
+      std::size_t Size() const { return Table->GetSize(); }
+      std::string GetName() const { return Table->GetName(); }
+      void Unlink() { Table->Unlink(); }
+
+      std::shared_ptr<SharedValueTable> Table;
   };
 
-  class PyClient: public RemoteClient
+  // Pushing never takes a lock, so producer threads only contend for the GIL.
+  class PyUpdateQueue
   {
     public:
-      PyNode PyGetRootNode() { return PyNode(Server, OpcUa::ObjectID::RootFolder); }
-      PyNode PyGetObjectsNode() { return PyNode(Server, OpcUa::ObjectID::ObjectsFolder); }
-      PyNode PyGetNode(PyNodeID nodeid) { return PyNode(RemoteClient::GetNode(nodeid)); }
-      //PyNode PyGetNodeFromPath(const python::object& path) { return Client::Client::GetNodeFromPath(FromList<std::string>(path)); }
+      explicit PyUpdateQueue(std::shared_ptr<UpdateQueue> queue)
+        : Queue(queue)
+      {
+      }
+      bool Push(const python::object& node, const python::object& value) { return Push2(node, value, 0); }
+      bool Push2(const python::object& node, const python::object& value, int64_t timestamp)
+      {
+        ValueUpdate update;
+        update.Node = GetNodeID(node);
+        update.Value = FromObject(value);
+        update.SourceTimestamp = timestamp;
+        return Queue->Push(std::move(update));
+      }
+      std::size_t PushMany(const python::object& nodes, const python::object& values) { return PushMany2(nodes, values, 0); }
+      std::size_t PushMany2(const python::object& nodes, const python::object& values, int64_t timestamp)
+      {
+        std::vector<NodeID> ids = GetNodeIDs(nodes);
+        if (static_cast<std::size_t>(python::len(values)) != ids.size())
+        {
+          throw std::logic_error("Number of values does not match number of nodes.");
+        }
+        std::size_t pushed = 0;
+        for (std::size_t i = 0; i < ids.size(); ++i)
+        {
+          ValueUpdate update;
+          update.Node = std::move(ids[i]);
+          update.Value = FromObject(values[i]);
+          update.SourceTimestamp = timestamp;
+          pushed += Queue->Push(std::move(update)) ? 1 : 0;
+        }
+        return pushed;
+      }
+      python::dict GetStats() const
+      {
+        const UpdateQueueStats stats = Queue->GetStats();
+        python::dict result;
+        result["pushed"] = stats.Pushed;
+        result["dropped"] = stats.Dropped;
+        result["applied"] = stats.Applied;
+        result["failed"] = stats.Failed;
+        result["batches"] = stats.Batches;
+        result["depth"] = stats.Depth;
+        result["max_depth"] = stats.MaxDepth;
+        result["capacity"] = stats.Capacity;
+        return result;
+      }
+      void Close()
+      {
+        ScopedGILRelease release;
+        Queue->Close();
+      }
+
+    private:
+      std::shared_ptr<UpdateQueue> Queue;
   };
 
+  // Lists and arrays hold one value per event, anything else is the value of every event.
+  bool IsEventColumn(const python::object& value)
+  {
+    PyObject* object = value.ptr();
+    return PyList_Check(object) || (PyObject_CheckBuffer(object) && !PyBytes_Check(object) && !PyByteArray_Check(object) && !PyMemoryView_Check(object));
+  }
 
+  EventBatch GetEventBatch(const python::object& source, const python::object& eventType, const python::dict& fields)
+  {
+    EventBatch batch;
+    batch.Source = GetNodeID(source);
+    batch.EventType = GetNodeID(eventType);
+    const python::list items = fields.items();
+    const std::size_t count = python::len(items);
+    std::vector<Variant> scalars(count);
+    std::vector<bool> isColumn(count);
+    batch.Fields.resize(count);
+    batch.Columns.resize(count);
+    batch.Count = 1;
+    bool haveColumn = false;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      batch.Fields[i] = python::extract<std::string>(items[i][0]);
+      const python::object value = items[i][1];
+      isColumn[i] = IsEventColumn(value);
+      if (!isColumn[i])
+      {
+        scalars[i] = FromObject(value);
+        continue;
+      }
+      const Variant column = FromObject(value);
+      if (!column.IsNul() && !SplitElements(column, batch.Columns[i]))
+      {
+        throw std::logic_error("Unsupported type of event field '" + batch.Fields[i] + "'.");
+      }
+      if (!haveColumn)
+      {
+        batch.Count = batch.Columns[i].size();
+        haveColumn = true;
+      }
+      else if (batch.Columns[i].size() != batch.Count)
+      {
+        throw std::logic_error("Event field columns have different lengths.");
+      }
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      if (!isColumn[i])
+      {
+        batch.Columns[i].assign(batch.Count, scalars[i]);
+      }
+      if (batch.Fields[i] == "Message")
+      {
+        // Clients expect localized text.
+        for (Variant& message : batch.Columns[i])
+        {
+          if (message.Type == VariantType::STRING)
+          {
+            message = LocalizedText(message.Value.String.front());
+          }
+        }
+      }
+    }
+    return batch;
+  }
 
   class PyOPCUAServer: public OPCUAServer
   {
     public:
-      PyNode PyGetRootNode() { return PyNode(Server, OpcUa::ObjectID::RootFolder); }
-      PyNode PyGetObjectsNode() { return PyNode(Server, OpcUa::ObjectID::ObjectsFolder); }
+      ~PyOPCUAServer()
+      {
+        CloseUpdateQueues();
+        RemoveSharedTables();
+        RemoveWriteHooks();
+        ForgetHistory();
+        ForgetLazyAddressSpace();
+        ForgetNodeCache(Nodes);
+        if (!CoreAddressSpacePath.empty())
+        {
+          unlink(CoreAddressSpacePath.c_str());
+        }
+      }
+      void PyStart()
+      {
+        if (LoadLazily && CoreAddressSpacePath.empty())
+        {
+          WriteCoreAddressSpace();
+        }
+        OPCUAServer::Start();
+        RegisterNodeCache(Server.get(), Nodes);
+        if (LoadLazily)
+        {
+          Lazy = std::make_shared<LazyAddressSpace>(Server, URI);
+          std::unique_lock<std::mutex> lock(LazyAddressSpacesMutex);
+          LazyAddressSpaces[Server.get()] = Lazy;
+        }
+        Sampling.reset(new SamplingEngine(Server));
+        Sampling->Start();
+        StartWorkers();
+      }
+      void PyStop()
+      {
+        CloseUpdateQueues();
+        RemoveSharedTables();
+        RemoveWriteHooks();
+        StopWorkers();
+        Sampling.reset();
+        ForgetHistory();
+        ForgetLazyAddressSpace();
+        ForgetNodeCache(Nodes);
+        OPCUAServer::Stop();
+      }
+      unsigned PyCreateSubscription(std::size_t queueSize) { return GetSampling().CreateSubscription(queueSize); }
+      void PyDeleteSubscription(unsigned subscription) { GetSampling().DeleteSubscription(subscription); }
+      unsigned PyAddMonitoredItem(unsigned subscription, const PyNode& node, double interval)
+      {
+        return PyAddMonitoredItem3(subscription, node, interval, DeadbandType::None, 0, 0, 0);
+      }
+      unsigned PyAddMonitoredItem2(unsigned subscription, const PyNode& node, double interval, DeadbandType deadband, double value)
+      {
+        return PyAddMonitoredItem3(subscription, node, interval, deadband, value, 0, 0);
+      }
+      unsigned PyAddMonitoredItem3(unsigned subscription, const PyNode& node, double interval, DeadbandType deadband, double value, double low, double high)
+      {
+        MonitoredItemParameters params;
+        params.Node = node.GetId();
+        params.SubscriptionID = subscription;
+        params.SamplingInterval = interval;
+        params.Deadband = deadband;
+        params.DeadbandValue = value;
+        params.RangeLow = low;
+        params.RangeHigh = high;
+        return GetSampling().AddItem(params);
+      }
+      void PyRemoveMonitoredItem(unsigned item) { GetSampling().RemoveItem(item); }
+      unsigned PyAddWriteHook(const python::object& nodes, const python::object& callback)
+      {
+        return PyAddWriteHook2(nodes, callback, 100, 50);
+      }
+      unsigned PyAddWriteHook2(const python::object& nodes, const python::object& callback, double samplingInterval, unsigned batchIntervalMs)
+      {
+        PyWriteHookCallback onWrite;
+        onWrite.Server = Server;
+        onWrite.Callable = ShareCallable(callback);
+        const std::vector<NodeID> ids = GetNodeIDs(nodes);
+        std::unique_ptr<WriteHook> hook(new WriteHook(Server, GetSampling(), ids, samplingInterval, batchIntervalMs, onWrite));
+        const unsigned id = NextWriteHookID++;
+        WriteHooks[id] = std::move(hook);
+        return id;
+      }
+      void PyRemoveWriteHook(unsigned id)
+      {
+        std::map<unsigned, std::unique_ptr<WriteHook>>::iterator it = WriteHooks.find(id);
+        if (it == WriteHooks.end())
+        {
+          throw std::logic_error("Unknown write hook.");
+        }
+        std::unique_ptr<WriteHook> hook = std::move(it->second);
+        WriteHooks.erase(it);
+        // The dispatcher thread may be waiting for the GIL.
+        ScopedGILRelease release;
+        hook.reset();
+      }
+      python::dict PyGetWriteHookStats(unsigned id)
+      {
+        std::map<unsigned, std::unique_ptr<WriteHook>>::iterator it = WriteHooks.find(id);
+        if (it == WriteHooks.end())
+        {
+          throw std::logic_error("Unknown write hook.");
+        }
+        const WriteHookStats stats = it->second->GetStats();
+        python::dict result;
+        result["events"] = stats.Events;
+        result["batches"] = stats.Batches;
+        result["callback_errors"] = stats.CallbackErrors;
+        return result;
+      }
+      unsigned PyAddSharedTable(const PySharedValueTable& table, const python::object& nodes)
+      {
+        return PyAddSharedTable2(table, nodes, 10);
+      }
+      unsigned PyAddSharedTable2(const PySharedValueTable& table, const python::object& nodes, unsigned intervalMs)
+      {
+        if (!Server)
+        {
+          throw std::logic_error("Server is not started.");
+        }
+        std::unique_ptr<SharedTableFeeder> feeder(new SharedTableFeeder(Server, table.Table, GetNodeIDs(nodes), intervalMs));
+        const unsigned id = NextSharedTableID++;
+        SharedTables[id] = std::move(feeder);
+        return id;
+      }
+      void PyRemoveSharedTable(unsigned id)
+      {
+        std::map<unsigned, std::unique_ptr<SharedTableFeeder>>::iterator it = SharedTables.find(id);
+        if (it == SharedTables.end())
+        {
+          throw std::logic_error("Unknown shared value table.");
+        }
+        std::unique_ptr<SharedTableFeeder> feeder = std::move(it->second);
+        SharedTables.erase(it);
+        ScopedGILRelease release;
+        feeder.reset();
+      }
+      void PySyncSharedTable(unsigned id)
+      {
+        std::map<unsigned, std::unique_ptr<SharedTableFeeder>>::iterator it = SharedTables.find(id);
+        if (it == SharedTables.end())
+        {
+          throw std::logic_error("Unknown shared value table.");
+        }
+        SharedTableFeeder& feeder = *it->second;
+        ScopedGILRelease release;
+        feeder.Sync();
+      }
+      python::dict PyGetSharedTableStats(unsigned id)
+      {
+        std::map<unsigned, std::unique_ptr<SharedTableFeeder>>::iterator it = SharedTables.find(id);
+        if (it == SharedTables.end())
+        {
+          throw std::logic_error("Unknown shared value table.");
+        }
+        const SharedTableFeederStats stats = it->second->GetStats();
+        python::dict result;
+        result["ticks"] = stats.Ticks;
+        result["updates"] = stats.Updates;
+        result["failed"] = stats.Failed;
+        result["busy"] = stats.Busy;
+        return result;
+      }
+      PyUpdateQueue PyCreateUpdateQueue() { return PyCreateUpdateQueue4(65536, UpdateQueuePolicy::DropNewest, 1000, 1); }
+      PyUpdateQueue PyCreateUpdateQueue2(std::size_t capacity) { return PyCreateUpdateQueue4(capacity, UpdateQueuePolicy::DropNewest, 1000, 1); }
+      PyUpdateQueue PyCreateUpdateQueue3(std::size_t capacity, UpdateQueuePolicy policy) { return PyCreateUpdateQueue4(capacity, policy, 1000, 1); }
+      PyUpdateQueue PyCreateUpdateQueue4(std::size_t capacity, UpdateQueuePolicy policy, std::size_t batchSize, unsigned intervalMs)
+      {
+        if (!Server)
+        {
+          throw std::logic_error("Server is not started.");
+        }
+        std::shared_ptr<UpdateQueue> queue = std::make_shared<UpdateQueue>(Server, capacity, policy, batchSize, intervalMs);
+        UpdateQueues.erase(std::remove_if(UpdateQueues.begin(), UpdateQueues.end(), [](const std::weak_ptr<UpdateQueue>& q){ return q.expired(); }), UpdateQueues.end());
+        UpdateQueues.push_back(queue);
+        return PyUpdateQueue(queue);
+      }
+      python::list PyInstantiate(const PyNode& templateNode, const PyNode& parent, unsigned count, const std::string& namePattern, const std::string& idPattern)
+      {
+        std::vector<Node> roots;
+        {
+          ScopedGILRelease release;
+          const SubtreeTemplate subtree(Server, templateNode.GetId());
+          roots = subtree.Instantiate(parent, count, namePattern, idPattern);
+        }
+        python::list result;
+        for (const Node& root : roots)
+        {
+          result.append(ToPyNode(root));
+        }
+        return result;
+      }
+      python::list PyPublish(unsigned subscription, std::size_t maxCount)
+      {
+        return PyPublish2(subscription, maxCount, 0);
+      }
+      python::list PyPublish2(unsigned subscription, std::size_t maxCount, unsigned waitMs)
+      {
+        SamplingEngine& sampling = GetSampling();
+        std::vector<MonitoredItemNotification> notifications;
+        {
+          ScopedGILRelease release;
+          notifications = sampling.Publish(subscription, maxCount, waitMs);
+        }
+        python::list result;
+        for (const MonitoredItemNotification& notification : notifications)
+        {
+          const DataValue& value = notification.Value;
+          result.append(python::make_tuple(notification.ItemID, ToObject(value.Value), value.SourceTimestamp.Value, static_cast<uint32_t>(value.Status)));
+        }
+        return result;
+      }
+      unsigned PyAddEventItem(unsigned subscription, const python::object& notifier, const python::object& fields)
+      {
+        return GetSampling().AddEventItem(subscription, GetNodeID(notifier), FromList<std::string>(fields));
+      }
+      std::size_t PyFireEvents(const python::object& source, const python::object& eventType, const python::dict& fields)
+      {
+        SamplingEngine& sampling = GetSampling();
+        const EventBatch batch = GetEventBatch(source, eventType, fields);
+        ScopedGILRelease release;
+        sampling.FireEvents(batch);
+        return batch.Count;
+      }
+      python::list PyPublishEvents(unsigned subscription, std::size_t maxCount)
+      {
+        python::list result;
+        for (const EventNotification& notification : GetSampling().PublishEvents(subscription, maxCount))
+        {
+          python::list fields;
+          for (const Variant& field : notification.Fields)
+          {
+            fields.append(ToObject(field));
+          }
+          result.append(python::make_tuple(notification.ItemID, fields));
+        }
+        return result;
+      }
+      python::dict PyGetSamplingStats()
+      {
+        const SamplingStats stats = GetSampling().GetStats();
+        python::dict result;
+        result["samples"] = stats.Samples;
+        result["notifications"] = stats.Notifications;
+        result["events"] = stats.Events;
+        result["overflows"] = stats.Overflows;
+        result["late_ticks"] = stats.LateTicks;
+        result["read_errors"] = stats.ReadErrors;
+        result["callback_errors"] = stats.CallbackErrors;
+        result["items"] = stats.Items;
+        result["bytes"] = stats.Bytes;
+        return result;
+      }
+      python::dict PyMemoryStats()
+      {
+        std::map<NodeClass, NodeClassMemory> nodes;
+        {
+          ScopedGILRelease release;
+          nodes = CollectNodeMemory(Server, NodeID(ObjectID::RootFolder));
+        }
+        python::dict classes;
+        std::size_t total = 0;
+        for (const std::pair<const NodeClass, NodeClassMemory>& item : nodes)
+        {
+          const NodeClassMemory& memory = item.second;
+          python::dict stats;
+          stats["nodes"] = memory.Nodes;
+          stats["attributes"] = memory.Attributes;
+          stats["references"] = memory.References;
+          stats["bytes"] = memory.Bytes;
+          stats["bytes_per_node"] = memory.Nodes ? memory.Bytes / memory.Nodes : 0;
+          classes[item.first] = stats;
+          total += memory.Bytes;
+        }
+        const std::size_t sampling = Sampling ? Sampling->GetStats().Bytes : 0;
+        python::dict result;
+        result["nodes"] = classes;
+        result["sampling_bytes"] = sampling;
+        result["total_bytes"] = total + sampling;
+        return result;
+      }
+      void PyEnableHistory(const std::string& directory) { PyEnableHistory2(directory, 1 << 16, 100); }
+      void PyEnableHistory2(const std::string& directory, std::size_t recordsPerSegment, unsigned commitIntervalMs)
+      {
+        if (History)
+        {
+          throw std::logic_error("History is already enabled.");
+        }
+        History = std::make_shared<NodeHistory>();
+        History->Log = std::make_shared<HistoryLog>(directory, recordsPerSegment, commitIntervalMs);
+      }
+      void PySetHistoryRetention(std::size_t maxSegments, double maxAgeSeconds)
+      {
+        HistoryRetention retention;
+        retention.MaxSegments = maxSegments;
+        retention.MaxAge = static_cast<int64_t>(maxAgeSeconds * 10000000);
+        GetHistory().Log->SetRetention(retention);
+      }
+      void PyHistorize(const PyNode& node) { PyHistorize2(node, 0); }
+      void PyHistorize2(const PyNode& node, double samplingInterval)
+      {
+        NodeHistory& history = GetHistory();
+        const std::string series = ToString(node.GetId());
+        std::unique_lock<std::mutex> lock(NodeHistoriesMutex);
+        NodeHistories[node.GetServer().get()] = History;
+        uint32_t& item = history.Series[series];
+        if (samplingInterval <= 0 || item)
+        {
+          return;
+        }
+        // The sampler takes NodeHistoriesMutex only in the callback, outside of its own locks.
+        SamplingEngine& sampling = GetSampling();
+        if (!history.Subscription)
+        {
+          std::shared_ptr<NodeHistory> shared = History;
+          history.Subscription = sampling.CreateSubscription([shared](const std::vector<MonitoredItemNotification>& notifications)
+            {
+              RecordSamples(*shared, notifications);
+            });
+        }
+        MonitoredItemParameters params;
+        params.Node = node.GetId();
+        params.SubscriptionID = history.Subscription;
+        params.SamplingInterval = samplingInterval;
+        item = sampling.AddItem(params);
+        history.Items[item] = series;
+      }
+      void PyFlushHistory() { GetHistory().Log->Flush(); }
+      python::dict PyGetHistoryStats()
+      {
+        const HistoryStats stats = GetHistory().Log->GetStats();
+        python::dict result;
+        result["appended"] = stats.Appended;
+        result["committed"] = stats.Committed;
+        result["dropped"] = stats.Dropped;
+        result["failed"] = stats.Failed;
+        result["commits"] = stats.Commits;
+        result["segments_removed"] = stats.SegmentsRemoved;
+        return result;
+      }
+      python::object PyGetRootNode() { return ToPyNode(Node(Server, OpcUa::ObjectID::RootFolder)); }
+      python::object PyGetObjectsNode() { return ToPyNode(Node(Server, OpcUa::ObjectID::ObjectsFolder)); }
       //PyNode GetNode(NodeID nodeid) { return PyNode::FromNode(OPCUAServer::GetNode(nodeid)); }
-      PyNode PyGetNode(PyNodeID nodeid) { return PyNode(OPCUAServer::GetNode(nodeid)); }
-      PyNode PyGetNodeFromPath(const python::object& path) { return OPCUAServer::GetNodeFromPath(FromList<std::string>(path)); }
+      python::object PyGetNode(PyNodeID nodeid)
+      {
+        if (Lazy)
+        {
+          Lazy->Materialize(nodeid);
+        }
+        return ToPyNode(OPCUAServer::GetNode(nodeid));
+      }
+      python::object PyGetNodeFromPath(const python::object& path)
+      {
+        const std::vector<std::string> names = FromList<std::string>(path);
+        if (Lazy)
+        {
+          std::vector<QualifiedName> qualifiedNames;
+          for (const std::string& name : names)
+          {
+            qualifiedNames.push_back(ToQualifiedName(name, 0));
+          }
+          Lazy->MaterializePath(qualifiedNames);
+        }
+        return ToPyNode(OPCUAServer::GetNodeFromPath(names));
+      }
+      python::dict PyReadValues(const python::object& nodes)
+      {
+        MaterializeNodes(nodes);
+        return ReadValueColumns(Server, Workers, nodes);
+      }
+      python::list PyTranslatePaths(const python::object& paths) { return TranslatePaths(Server, Workers, paths, Lazy.get()); }
+      python::list PyRegisterNodes(const python::object& nodes)
+      {
+        MaterializeNodes(nodes);
+        return RegisterNodes(Server, Workers, Registry, nodes);
+      }
+      void PyUnregisterNodes(const python::object& handles) { UnregisterNodes(Registry, handles); }
+      python::dict PyReadAttributes(const python::object& nodes, const python::object& attributes)
+      {
+        MaterializeNodes(nodes);
+        return ReadAttributeColumns(Server, Workers, nodes, attributes);
+      }
+      void PySetURI(const std::string& uri)
+      {
+        URI = uri;
+        OPCUAServer::SetURI(uri);
+      }
+      void PySetLoadCppAddressSpace(bool load) { PySetLoadCppAddressSpace2(load, false); }
+      // Lazy loading takes effect at the next start.
+      void PySetLoadCppAddressSpace2(bool load, bool lazy)
+      {
+        LoadLazily = load && lazy;
+        OPCUAServer::SetLoadCppAddressSpace(load && !lazy);
+      }
+      python::dict PyGetAddressSpaceStats()
+      {
+        python::dict result;
+        result["lazy"] = Lazy ? Lazy->GetLazyCount() : 0;
+        result["materialized"] = Lazy ? Lazy->GetMaterializedCount() : 0;
+        return result;
+      }
+      // Only the batch calls of this object use the workers, sessions of remote clients do not.
+      void PySetWorkerThreads(unsigned count) { PySetWorkerThreads2(count, 1000); }
+      void PySetWorkerThreads2(unsigned count, std::size_t chunkSize)
+      {
+        WorkerThreads = count;
+        WorkerChunkSize = chunkSize;
+        if (Server)
+        {
+          StartWorkers();
+        }
+      }
+      unsigned PyGetWorkerThreads() { return WorkerThreads; }
+
+    private:
+      void MaterializeNodes(const python::object& nodes)
+      {
+        if (Lazy)
+        {
+          Lazy->Materialize(GetNodeIDs(nodes));
+        }
+      }
+
+      // The server reads XML address spaces from files, the file stays until the server is destroyed.
+      void WriteCoreAddressSpace()
+      {
+        // The server loads address spaces from files only.
+        const char* directory = getenv("TMPDIR");
+        std::string pattern = std::string(directory && *directory ? directory : "/tmp") + "/opcua-ns0-XXXXXX";
+        std::vector<char> buffer(pattern.begin(), pattern.end());
+        buffer.push_back('\0');
+        char* path = buffer.data();
+        const int fd = mkstemp(path);
+        if (fd < 0)
+        {
+          throw std::logic_error("Cannot create a file for the standard address space in " + pattern.substr(0, pattern.rfind('/')) + ".");
+        }
+        close(fd);
+        std::ofstream out(path);
+        LazyAddressSpace::WriteCoreXml(out);
+        out.close();
+        if (!out)
+        {
+          unlink(path);
+          throw std::logic_error("Cannot write the standard address space.");
+        }
+        CoreAddressSpacePath = path;
+        OPCUAServer::AddAddressSpace(CoreAddressSpacePath);
+      }
+
+      void ForgetLazyAddressSpace()
+      {
+        std::unique_lock<std::mutex> lock(LazyAddressSpacesMutex);
+        for (auto it = LazyAddressSpaces.begin(); it != LazyAddressSpaces.end();)
+        {
+          it = it->second == Lazy ? LazyAddressSpaces.erase(it) : std::next(it);
+        }
+        Lazy.reset();
+      }
+
+      void StartWorkers()
+      {
+        Workers = WorkerThreads > 1 ? std::make_shared<RequestPipeline>(Server, WorkerThreads, WorkerChunkSize) : std::shared_ptr<RequestPipeline>();
+      }
+
+      void StopWorkers()
+      {
+        Workers.reset();
+      }
+
+      void RemoveWriteHooks()
+      {
+        std::map<unsigned, std::unique_ptr<WriteHook>> hooks;
+        hooks.swap(WriteHooks);
+        ScopedGILRelease release;
+        hooks.clear();
+      }
+
+      // Queues stay usable from Python after stop, but drop whatever is pushed.
+      void CloseUpdateQueues()
+      {
+        std::vector<std::shared_ptr<UpdateQueue>> queues;
+        for (const std::weak_ptr<UpdateQueue>& queue : UpdateQueues)
+        {
+          if (std::shared_ptr<UpdateQueue> alive = queue.lock())
+          {
+            queues.push_back(alive);
+          }
+        }
+        UpdateQueues.clear();
+        ScopedGILRelease release;
+        for (const std::shared_ptr<UpdateQueue>& queue : queues)
+        {
+          queue->Close();
+        }
+      }
+
+      void RemoveSharedTables()
+      {
+        std::map<unsigned, std::unique_ptr<SharedTableFeeder>> tables;
+        tables.swap(SharedTables);
+        ScopedGILRelease release;
+        tables.clear();
+      }
+
+      SamplingEngine& GetSampling()
+      {
+        if (!Sampling)
+        {
+          throw std::logic_error("Server is not started.");
+        }
+        return *Sampling;
+      }
+
+      NodeHistory& GetHistory()
+      {
+        if (!History)
+        {
+          throw std::logic_error("History is not enabled. Call enable_history first.");
+        }
+        return *History;
+      }
+
+      void ForgetHistory()
+      {
+        std::unique_lock<std::mutex> lock(NodeHistoriesMutex);
+        for (auto it = NodeHistories.begin(); it != NodeHistories.end();)
+        {
+          it = it->second == History ? NodeHistories.erase(it) : std::next(it);
+        }
+        // The monitored items went away with the sampler.
+        if (History)
+        {
+          History->Series.clear();
+          History->Items.clear();
+          History->Subscription = 0;
+        }
+      }
+
+    private:
+      std::shared_ptr<NodeHistory> History;
+      std::unique_ptr<SamplingEngine> Sampling;
+      unsigned WorkerThreads = 1;
+      std::size_t WorkerChunkSize = 1000;
+      std::shared_ptr<RequestPipeline> Workers;
+      std::shared_ptr<NodeRegistry> Registry = std::make_shared<NodeRegistry>();
+      std::map<unsigned, std::unique_ptr<WriteHook>> WriteHooks;
+      unsigned NextWriteHookID = 1;
+      std::map<unsigned, std::unique_ptr<SharedTableFeeder>> SharedTables;
+      unsigned NextSharedTableID = 1;
+      std::vector<std::weak_ptr<UpdateQueue>> UpdateQueues;
+      std::string URI;
+      bool LoadLazily = false;
+      std::string CoreAddressSpacePath;
+      std::shared_ptr<LazyAddressSpace> Lazy;
+      PyNodeCache Nodes;
   };
 }
 
@@ -618,6 +3074,22 @@ BOOST_PYTHON_MODULE(MODULE_NAME) // MODULE_NAME specifies via preprocessor in co
     .value("BOTH",   OpcUa::TimestampsToReturn::BOTH)
     .value("SERVER", OpcUa::TimestampsToReturn::NEITHER);
 
+  enum_<OpcUa::DeadbandType>("DeadbandType")
+    .value("NONE", OpcUa::DeadbandType::None)
+    .value("ABSOLUTE", OpcUa::DeadbandType::Absolute)
+    .value("PERCENT", OpcUa::DeadbandType::Percent);
+
+  enum_<OpcUa::AggregateType>("AggregateType")
+    .value("COUNT", OpcUa::AggregateType::Count)
+    .value("MINIMUM", OpcUa::AggregateType::Minimum)
+    .value("MAXIMUM", OpcUa::AggregateType::Maximum)
+    .value("AVERAGE", OpcUa::AggregateType::Average)
+    .value("INTERPOLATIVE", OpcUa::AggregateType::Interpolative);
+
+  enum_<OpcUa::UpdateQueuePolicy>("UpdateQueuePolicy")
+    .value("DROP_NEWEST", OpcUa::UpdateQueuePolicy::DropNewest)
+    .value("DROP_OLDEST", OpcUa::UpdateQueuePolicy::DropOldest);
+
   enum_<OpcUa::AttributeID>("AttributeID")
     .value("ACCESS_LEVEL", OpcUa::AttributeID::ACCESS_LEVEL)
     .value("ARRAY_DIMENSIONS", OpcUa::AttributeID::ARRAY_DIMENSIONS)
@@ -658,6 +3130,44 @@ BOOST_PYTHON_MODULE(MODULE_NAME) // MODULE_NAME specifies via preprocessor in co
     .def(self == self)
     ;
 
+  class_<PyNodeIDArray>("NodeIDArray")
+    .def("__len__", &PyNodeIDArray::Size)
+    .def("__getitem__", &PyNodeIDArray::Get)
+    ;
+
+  class_<PyRegisteredNode>("RegisteredNode", no_init)
+    .def("get_value", &PyRegisteredNode::PyGetValue)
+    .def("set_value", &PyRegisteredNode::PySetValue)
+    .def("get_id", &PyRegisteredNode::PyGetNodeID)
+    .def("get_local_alias", &PyRegisteredNode::GetAlias,
+         "Key of the node in the registry of this process. It is never sent, requests carry the full NodeID.")
+    ;
+
+  class_<PySharedValueTable, boost::noncopyable>("SharedValueTable", init<std::string, std::size_t>())
+    .def(init<std::string>())
+    .def("write", &PySharedValueTable::Write)
+    .def("write", &PySharedValueTable::Write2)
+    .def("read", &PySharedValueTable::Read)
+    .def("unlink", &PySharedValueTable::Unlink)
+    .def("get_name", &PySharedValueTable::GetName)
+    .def("__len__", &PySharedValueTable::Size)
+    ;
+
+  class_<PyUpdateQueue>("UpdateQueue", no_init)
+    .def("push", &PyUpdateQueue::Push)
+    .def("push", &PyUpdateQueue::Push2)
+    .def("push_many", &PyUpdateQueue::PushMany)
+    .def("push_many", &PyUpdateQueue::PushMany2)
+    .def("get_stats", &PyUpdateQueue::GetStats)
+    .def("close", &PyUpdateQueue::Close)
+    ;
+
+  def("parse_node_ids", &ParseNodeIDs);
+  def("parse_node_ids", &ParseNodeIDs2);
+  def("format_node_ids", &FormatNodeIDList);
+  def("clear_endpoint_cache", &ClearEndpointCache);
+  def("allocation_stats", &PyGetAllocationStats);
+  def("aggregate_kernel", &GetAggregateKernel);
   
   class_<QualifiedName>("QualifiedName")
     .def(init<uint16_t, std::string>())
@@ -781,14 +3291,24 @@ BOOST_PYTHON_MODULE(MODULE_NAME) // MODULE_NAME specifies via preprocessor in co
           .def(init<Node>())
           .def("get_id", &PyNode::PyGetNodeID)
           .def("get_attribute", &PyNode::GetAttribute)
+          .def("get_attributes", &PyNode::PyGetAttributes)
           .def("set_attribute", &PyNode::SetAttribute)
           .def("get_value", &PyNode::PyGetValue)
+          .def("get_value", &PyNode::PyGetValueRange, (python::arg("index_range")))
+          .def("get_value_array", &PyNode::PyGetValueArray)
           .def("set_value", &PyNode::PySetValue)
           .def("set_value", &PyNode::PySetValue2) //should be possible to use default argument
+          .def("set_value", &PyNode::PySetValueRange, (python::arg("value"), python::arg("index_range")))
+          .def("read_history", &PyNode::PyReadHistory)
+          .def("read_history", &PyNode::PyReadHistory2)
+          .def("read_processed", &PyNode::PyReadProcessed)
           .def("get_properties", &PyNode::GetProperties)
           .def("get_variables", &PyNode::GetVariables)
           .def("get_name", &PyNode::PyGetName)
           .def("get_children", &PyNode::PyGetChildren)
+          .def("get_children_described", &PyNode::PyGetChildrenDescribed)
+          .def("get_children_described", &PyNode::PyGetChildrenDescribed2)
+          .def("get_children_described", &PyNode::PyGetChildrenDescribed3)
           .def("get_child", &PyNode::PyGetChild)
           .def("add_folder", &PyNode::PyAddFolder)
           .def("add_folder", &PyNode::PyAddFolder2)
@@ -811,8 +3331,15 @@ BOOST_PYTHON_MODULE(MODULE_NAME) // MODULE_NAME specifies via preprocessor in co
 
 
     class_<PyClient, boost::noncopyable>("Client")
-          .def("connect", &PyClient::Connect)
-          .def("disconnect", &PyClient::Disconnect)
+          .def("connect", &PyClient::PyConnect)
+          .def("disconnect", &PyClient::PyDisconnect)
+          .def("reconnect", &PyClient::PyReconnect)
+          .def("enable_auto_reconnect", &PyClient::PyEnableAutoReconnect)
+          .def("enable_auto_reconnect", &PyClient::PyEnableAutoReconnect2)
+          .def("disable_auto_reconnect", &PyClient::PyDisableAutoReconnect)
+          .def("get_connection_stats", &PyClient::PyGetConnectionStats)
+          .def("get_endpoints", &PyClient::PyGetEndpoints)
+          .def("find_servers", &PyClient::PyFindServers)
           .def("get_root_node", &PyClient::PyGetRootNode)
           .def("get_objects_node", &PyClient::PyGetObjectsNode)
           .def("get_node", &PyClient::PyGetNode)
@@ -824,6 +3351,26 @@ BOOST_PYTHON_MODULE(MODULE_NAME) // MODULE_NAME specifies via preprocessor in co
           .def("set_uri", &PyClient::SetURI)
           .def("set_security_policy", &PyClient::SetSecurityPolicy)
           .def("get_security_policy", &PyClient::GetSecurityPolicy)
+          .def("read_values", &PyClient::PyReadValues)
+          .def("translate_paths", &PyClient::PyTranslatePaths)
+          .def("register_local_nodes", &PyClient::PyRegisterNodes,
+               "Check the nodes once and return handles that read and write them without converting them again. "
+               "The registration is local to this process: the server is not asked for aliases, "
+               "requests still carry the full NodeID.")
+          .def("unregister_local_nodes", &PyClient::PyUnregisterNodes)
+          .def("read_attributes", &PyClient::PyReadAttributes)
+          .def("enable_write_behind", &PyClient::PyEnableWriteBehind)
+          .def("enable_write_behind", &PyClient::PyEnableWriteBehind2)
+          .def("disable_write_behind", &PyClient::PyDisableWriteBehind)
+          .def("flush", &PyClient::PyFlush)
+          .def("get_write_errors", &PyClient::PyGetWriteErrors)
+          .def("get_write_stats", &PyClient::PyGetWriteStats)
+          .def("write_values", &PyClient::PyWriteValues)
+          .def("set_request_chunk_size", &PyClient::PySetRequestChunkSize,
+               "Split read_values, write_values, read_attributes, translate_paths and register_local_nodes "
+               "into requests of at most chunk_size items, sent one after another; 0 sends each call as one request.")
+          .def("get_request_chunk_size", &PyClient::PyGetRequestChunkSize)
+          .def("get_request_stats", &PyClient::PyGetRequestStats)
       ;
 
 
@@ -831,19 +3378,80 @@ BOOST_PYTHON_MODULE(MODULE_NAME) // MODULE_NAME specifies via preprocessor in co
     //Node (OPCUAServer::*NodeFromPathQN)(const std::vector<QualifiedName>&) = &OPCUAServer::GetNodeFromPath;
 
     class_<PyOPCUAServer, boost::noncopyable >("Server" )
-          .def("start", &PyOPCUAServer::Start)
-          .def("stop", &PyOPCUAServer::Stop)
+          .def("start", &PyOPCUAServer::PyStart)
+          .def("stop", &PyOPCUAServer::PyStop)
           .def("get_root_node", &PyOPCUAServer::PyGetRootNode)
           .def("get_objects_node", &PyOPCUAServer::PyGetObjectsNode)
           .def("get_node", &PyOPCUAServer::PyGetNode)
           .def("get_node_from_path", &PyOPCUAServer::PyGetNodeFromPath)
+          .def("read_values", &PyOPCUAServer::PyReadValues)
+          .def("translate_paths", &PyOPCUAServer::PyTranslatePaths)
+          .def("register_local_nodes", &PyOPCUAServer::PyRegisterNodes,
+               "Resolve the nodes once and return handles that read and write them without looking them up again. "
+               "The registration is local to this process, it is not the RegisterNodes service.")
+          .def("unregister_local_nodes", &PyOPCUAServer::PyUnregisterNodes)
+          .def("read_attributes", &PyOPCUAServer::PyReadAttributes)
           //.def("get_node_from_qn_path", NodeFromPathQN)
           .def("set_config_file", &PyOPCUAServer::SetConfigFile)
-          .def("set_uri", &PyOPCUAServer::SetURI)
+          .def("set_uri", &PyOPCUAServer::PySetURI)
           .def("add_xml_address_space", &PyOPCUAServer::AddAddressSpace)
           .def("set_server_name", &PyOPCUAServer::SetServerName)
           .def("set_endpoint", &PyOPCUAServer::SetEndpoint)
-          .def("load_cpp_addressspace", &PyOPCUAServer::SetLoadCppAddressSpace)
+          .def("load_cpp_addressspace", &PyOPCUAServer::PySetLoadCppAddressSpace)
+          .def("load_cpp_addressspace", &PyOPCUAServer::PySetLoadCppAddressSpace2, (python::arg("load"), python::arg("lazy")),
+               "With lazy=True only the Server object is added at start; other standard nodes are added when this process "
+               "looks them up, e.g. through get_node, get_node_from_path, get_children or read_values. Remote clients never trigger that, so lazy "
+               "nodes such as the BaseEventType properties stay invisible to them until this process has looked them up.")
+          .def("get_address_space_stats", &PyOPCUAServer::PyGetAddressSpaceStats)
+          .def("enable_history", &PyOPCUAServer::PyEnableHistory)
+          .def("enable_history", &PyOPCUAServer::PyEnableHistory2)
+          .def("set_history_retention", &PyOPCUAServer::PySetHistoryRetention)
+          .def("historize", &PyOPCUAServer::PyHistorize,
+               "Store the values written with set_value in this process. Writes of remote clients are not seen.")
+          .def("historize", &PyOPCUAServer::PyHistorize2, (python::arg("node"), python::arg("sampling_interval")),
+               "Sample the node with the local sampler every sampling_interval milliseconds and store the changes, "
+               "whoever writes them.")
+          .def("flush_history", &PyOPCUAServer::PyFlushHistory)
+          .def("get_history_stats", &PyOPCUAServer::PyGetHistoryStats)
+          .def("create_local_subscription", &PyOPCUAServer::PyCreateSubscription,
+               "Subscription sampled in this process and read with publish_local. "
+               "It is not part of the subscription service of the server, remote clients do not see it.")
+          .def("delete_local_subscription", &PyOPCUAServer::PyDeleteSubscription)
+          .def("add_local_monitored_item", &PyOPCUAServer::PyAddMonitoredItem)
+          .def("add_local_monitored_item", &PyOPCUAServer::PyAddMonitoredItem2)
+          .def("add_local_monitored_item", &PyOPCUAServer::PyAddMonitoredItem3)
+          .def("remove_local_monitored_item", &PyOPCUAServer::PyRemoveMonitoredItem)
+          .def("publish_local", &PyOPCUAServer::PyPublish)
+          .def("publish_local", &PyOPCUAServer::PyPublish2, (python::arg("subscription"), python::arg("max_count"), python::arg("wait_ms")),
+               "Queued notifications of a local subscription, waiting up to wait_ms for the first one.")
+          .def("add_local_event_item", &PyOPCUAServer::PyAddEventItem)
+          .def("fire_local_events", &PyOPCUAServer::PyFireEvents,
+               "Events delivered to the event items of local subscriptions only. "
+               "They are not reported through the server, remote clients do not receive them.")
+          .def("publish_local_events", &PyOPCUAServer::PyPublishEvents)
+          .def("get_sampling_stats", &PyOPCUAServer::PyGetSamplingStats)
+          .def("instantiate", &PyOPCUAServer::PyInstantiate)
+          .def("add_write_hook", &PyOPCUAServer::PyAddWriteHook,
+               "Call back with batches of (node, value, previous, source_timestamp) for changes of the nodes. "
+               "Changes are found by sampling after the write was applied, so they cannot be rejected.")
+          .def("add_write_hook", &PyOPCUAServer::PyAddWriteHook2)
+          .def("remove_write_hook", &PyOPCUAServer::PyRemoveWriteHook)
+          .def("get_write_hook_stats", &PyOPCUAServer::PyGetWriteHookStats)
+          .def("add_shared_table", &PyOPCUAServer::PyAddSharedTable)
+          .def("add_shared_table", &PyOPCUAServer::PyAddSharedTable2)
+          .def("remove_shared_table", &PyOPCUAServer::PyRemoveSharedTable)
+          .def("sync_shared_table", &PyOPCUAServer::PySyncSharedTable)
+          .def("get_shared_table_stats", &PyOPCUAServer::PyGetSharedTableStats)
+          .def("update_queue", &PyOPCUAServer::PyCreateUpdateQueue)
+          .def("update_queue", &PyOPCUAServer::PyCreateUpdateQueue2)
+          .def("update_queue", &PyOPCUAServer::PyCreateUpdateQueue3)
+          .def("update_queue", &PyOPCUAServer::PyCreateUpdateQueue4)
+          .def("memory_stats", &PyOPCUAServer::PyMemoryStats)
+          .def("set_local_read_parallelism", &PyOPCUAServer::PySetWorkerThreads,
+               "Threads splitting read_values, read_attributes, translate_paths and register_local_nodes of this process. "
+               "Requests of remote clients are served as before and are not affected.")
+          .def("set_local_read_parallelism", &PyOPCUAServer::PySetWorkerThreads2, (python::arg("threads"), python::arg("chunk_size")))
+          .def("get_local_read_parallelism", &PyOPCUAServer::PyGetWorkerThreads)
       ;
 
 
@@ -547,9 +547,9 @@ namespace OpcUa
     }
   };
 
-  WriteValue GetWriteValue(const PyWriteValue& pyValue)
+  // Fills a value already placed in the request instead of returning a copy.
+  void GetWriteValue(const PyWriteValue& pyValue, WriteValue& result)
   {
-    WriteValue result;
     result.Attribute = static_cast<AttributeID>(pyValue.Attribute);
     result.Node = GetNode(pyValue.Node);
     result.NumericRange = pyValue.NumericRange;
@@ -583,7 +583,6 @@ namespace OpcUa
       result.Data.Value = FromObject(pyValue.Data.Value);
       result.Data.Encoding |= DATA_VALUE;
     }
-    return result;
   }
 
   class PyServer
@@ -632,32 +631,34 @@ namespace OpcUa
       params.TimestampsType = static_cast<TimestampsToReturn>(in.TimestampsType);
 
       std::size_t listSize = python::len(in.AttributesToRead);
+      params.AttributesToRead.resize(listSize);
       for (std::size_t i = 0; i < listSize; ++i)
       {
-        const PyAttributeValueID& value = python::extract<PyAttributeValueID>(in.AttributesToRead[i]);
-        OpcUa::AttributeValueID attr;
+        python::object item = in.AttributesToRead[i];
+        const PyAttributeValueID& value = python::extract<const PyAttributeValueID&>(item);
+        OpcUa::AttributeValueID& attr = params.AttributesToRead[i];
         attr.Attribute = static_cast<OpcUa::AttributeID>(value.Attribute);
         attr.DataEncoding.NamespaceIndex = value.DataEncoding.NamespaceIndex;
         attr.DataEncoding.Name = value.DataEncoding.Name;
         attr.IndexRange = value.IndexRange;
         attr.Node = GetNode(value.Node);
-        params.AttributesToRead.push_back(attr);
       }
 
-      std::vector<DataValue> data = Impl->Attributes()->Read(params);
+      const std::vector<DataValue> data = Impl->Attributes()->Read(params);
       return ToList<PyDataValue, DataValue>(data);
     }
 
     //    std::vector<StatusCode> Write(const std::vector<OpcUa::WriteValue>& filter) = 0;
     python::list Write(const python::list& in)
     {
-      const std::vector<PyWriteValue>& pyValues = FromList<PyWriteValue>(in);
-      std::vector<WriteValue> values;
-      for (std::vector<PyWriteValue>::const_iterator valueIt = pyValues.begin(); valueIt != pyValues.end(); ++valueIt)
+      // Python values are used in place, the request is sized once.
+      const std::size_t listSize = python::len(in);
+      std::vector<WriteValue> values(listSize);
+      for (std::size_t i = 0; i < listSize; ++i)
       {
-        const PyWriteValue& pyValue = *valueIt;
-        const WriteValue& value = GetWriteValue(pyValue);
-        values.push_back(value);
+        python::object item = in[i];
+        const PyWriteValue& pyValue = python::extract<const PyWriteValue&>(item);
+        GetWriteValue(pyValue, values[i]);
       }
       const python::list& result = ToList<unsigned, StatusCode>(Impl->Attributes()->Write(values));
       return result;
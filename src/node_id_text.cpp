@@ -0,0 +1,370 @@
+/// @brief Conversion of NodeIDs from and to the "ns=2;s=Name" text form.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "node_id_text.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace
+{
+  const char Base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+  void ThrowInvalid(const std::string& text)
+  {
+    throw std::logic_error("Invalid NodeID '" + text + "'.");
+  }
+
+  bool StartsWith(const char* begin, const char* end, const char* prefix)
+  {
+    for (; *prefix; ++prefix, ++begin)
+    {
+      if (begin == end || *begin != *prefix)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool ParseUInt(const char* begin, const char* end, uint64_t max, uint64_t& result)
+  {
+    if (begin == end)
+    {
+      return false;
+    }
+    result = 0;
+    for (; begin != end; ++begin)
+    {
+      if (*begin < '0' || *begin > '9')
+      {
+        return false;
+      }
+      result = result * 10 + (*begin - '0');
+      if (result > max)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  int HexValue(char c)
+  {
+    if (c >= '0' && c <= '9')
+    {
+      return c - '0';
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+      return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+      return c - 'A' + 10;
+    }
+    return -1;
+  }
+
+  bool ParseHex(const char*& pos, const char* end, unsigned digits, uint64_t& result)
+  {
+    result = 0;
+    for (unsigned i = 0; i < digits; ++i, ++pos)
+    {
+      const int value = pos == end ? -1 : HexValue(*pos);
+      if (value < 0)
+      {
+        return false;
+      }
+      result = (result << 4) | value;
+    }
+    return true;
+  }
+
+  // 8-4-4-4-12 hex digits.
+  bool ParseGuid(const char* pos, const char* end, OpcUa::Guid& guid)
+  {
+    uint64_t value = 0;
+    if (!ParseHex(pos, end, 8, value) || pos == end || *pos++ != '-')
+    {
+      return false;
+    }
+    guid.Data1 = static_cast<uint32_t>(value);
+    if (!ParseHex(pos, end, 4, value) || pos == end || *pos++ != '-')
+    {
+      return false;
+    }
+    guid.Data2 = static_cast<uint16_t>(value);
+    if (!ParseHex(pos, end, 4, value) || pos == end || *pos++ != '-')
+    {
+      return false;
+    }
+    guid.Data3 = static_cast<uint16_t>(value);
+    for (unsigned i = 0; i < 8; ++i)
+    {
+      if (i == 2 && (pos == end || *pos++ != '-'))
+      {
+        return false;
+      }
+      if (!ParseHex(pos, end, 2, value))
+      {
+        return false;
+      }
+      guid.Data4[i] = static_cast<uint8_t>(value);
+    }
+    return pos == end;
+  }
+
+  struct Base64Table
+  {
+    int Values[256];
+
+    Base64Table()
+    {
+      std::fill(Values, Values + 256, -1);
+      for (int i = 0; i < 64; ++i)
+      {
+        Values[static_cast<unsigned char>(Base64Chars[i])] = i;
+      }
+    }
+  };
+
+  bool DecodeBase64(const char* pos, const char* end, std::vector<uint8_t>& result)
+  {
+    static const Base64Table table;
+
+    while (pos != end && *(end - 1) == '=')
+    {
+      --end;
+    }
+    result.clear();
+    result.reserve((end - pos) * 3 / 4);
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (; pos != end; ++pos)
+    {
+      const int value = table.Values[static_cast<unsigned char>(*pos)];
+      if (value < 0)
+      {
+        return false;
+      }
+      buffer = (buffer << 6) | value;
+      bits += 6;
+      if (bits >= 8)
+      {
+        bits -= 8;
+        result.push_back(static_cast<uint8_t>(buffer >> bits));
+      }
+    }
+    return true;
+  }
+
+  void EncodeBase64(const std::vector<uint8_t>& data, std::string& result)
+  {
+    std::size_t i = 0;
+    for (; i + 2 < data.size(); i += 3)
+    {
+      const uint32_t value = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+      result += Base64Chars[value >> 18];
+      result += Base64Chars[(value >> 12) & 0x3f];
+      result += Base64Chars[(value >> 6) & 0x3f];
+      result += Base64Chars[value & 0x3f];
+    }
+    if (i + 1 == data.size())
+    {
+      const uint32_t value = data[i] << 16;
+      result += Base64Chars[value >> 18];
+      result += Base64Chars[(value >> 12) & 0x3f];
+      result += "==";
+    }
+    else if (i + 2 == data.size())
+    {
+      const uint32_t value = (data[i] << 16) | (data[i + 1] << 8);
+      result += Base64Chars[value >> 18];
+      result += Base64Chars[(value >> 12) & 0x3f];
+      result += Base64Chars[(value >> 6) & 0x3f];
+      result += '=';
+    }
+  }
+}
+
+namespace OpcUa
+{
+
+  NodeIDParser::NodeIDParser(const std::vector<std::string>& namespaceURIs)
+  {
+    for (std::size_t i = 0; i < namespaceURIs.size(); ++i)
+    {
+      Namespaces.insert(std::make_pair(namespaceURIs[i], static_cast<uint16_t>(i)));
+    }
+  }
+
+  NodeID NodeIDParser::Parse(const std::string& text) const
+  {
+    const char* pos = text.data();
+    const char* const end = pos + text.size();
+
+    uint16_t index = 0;
+    std::string uri;
+    if (StartsWith(pos, end, "ns="))
+    {
+      const char* separator = std::find(pos, end, ';');
+      uint64_t value = 0;
+      if (separator == end || !ParseUInt(pos + 3, separator, 0xffff, value))
+      {
+        ThrowInvalid(text);
+      }
+      index = static_cast<uint16_t>(value);
+      pos = separator + 1;
+    }
+    else if (StartsWith(pos, end, "nsu="))
+    {
+      const char* separator = std::find(pos, end, ';');
+      if (separator == end || separator == pos + 4)
+      {
+        ThrowInvalid(text);
+      }
+      uri.assign(pos + 4, separator);
+      std::unordered_map<std::string, uint16_t>::const_iterator it = Namespaces.find(uri);
+      if (it != Namespaces.end())
+      {
+        index = it->second;
+        uri.clear();
+      }
+      pos = separator + 1;
+    }
+
+    if (end - pos < 2 || pos[1] != '=')
+    {
+      ThrowInvalid(text);
+    }
+    const char type = pos[0];
+    pos += 2;
+
+    NodeID result;
+    switch (type)
+    {
+      case 'i':
+      {
+        uint64_t value = 0;
+        if (!ParseUInt(pos, end, 0xffffffff, value))
+        {
+          ThrowInvalid(text);
+        }
+        result = NumericNodeID(static_cast<uint32_t>(value), index);
+        break;
+      }
+      case 's':
+      {
+        result = StringNodeID(std::string(pos, end), index);
+        break;
+      }
+      case 'g':
+      {
+        Guid guid;
+        if (!ParseGuid(pos, end, guid))
+        {
+          ThrowInvalid(text);
+        }
+        result = GuidNodeID(guid, index);
+        break;
+      }
+      case 'b':
+      {
+        std::vector<uint8_t> data;
+        if (!DecodeBase64(pos, end, data))
+        {
+          ThrowInvalid(text);
+        }
+        result = BinaryNodeID(data, index);
+        break;
+      }
+      default:
+      {
+        ThrowInvalid(text);
+      }
+    }
+
+    if (!uri.empty())
+    {
+      result.SetNamespaceURI(uri);
+    }
+    return result;
+  }
+
+  std::vector<NodeID> NodeIDParser::Parse(const std::vector<std::string>& texts) const
+  {
+    std::vector<NodeID> result;
+    result.reserve(texts.size());
+    for (const std::string& text : texts)
+    {
+      result.push_back(Parse(text));
+    }
+    return result;
+  }
+
+  std::string FormatNodeID(const NodeID& id)
+  {
+    std::string result;
+    char buffer[64];
+    if (id.HasNamespaceURI())
+    {
+      result += "nsu=";
+      result += id.NamespaceURI;
+      result += ';';
+    }
+    else if (const uint32_t index = id.GetNamespaceIndex())
+    {
+      std::snprintf(buffer, sizeof(buffer), "ns=%u;", index);
+      result += buffer;
+    }
+
+    if (id.IsInteger())
+    {
+      std::snprintf(buffer, sizeof(buffer), "i=%u", id.GetIntegerIdentifier());
+      result += buffer;
+    }
+    else if (id.IsString())
+    {
+      result += "s=";
+      result += id.GetStringIdentifier();
+    }
+    else if (id.IsGuid())
+    {
+      const Guid guid = id.GetGuidIdentifier();
+      std::snprintf(buffer, sizeof(buffer), "g=%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X",
+        guid.Data1, guid.Data2, guid.Data3,
+        guid.Data4[0], guid.Data4[1], guid.Data4[2], guid.Data4[3],
+        guid.Data4[4], guid.Data4[5], guid.Data4[6], guid.Data4[7]);
+      result += buffer;
+    }
+    else if (id.IsBinary())
+    {
+      result += "b=";
+      EncodeBase64(id.GetBinaryIdentifier(), result);
+    }
+    else
+    {
+      throw std::logic_error("Invalid Node ID encoding value.");
+    }
+    return result;
+  }
+
+  std::vector<std::string> FormatNodeIDs(const std::vector<NodeID>& ids)
+  {
+    std::vector<std::string> result;
+    result.reserve(ids.size());
+    for (const NodeID& id : ids)
+    {
+      result.push_back(FormatNodeID(id));
+    }
+    return result;
+  }
+
+}
@@ -0,0 +1,37 @@
+/// @brief Conversion of NodeIDs from and to the "ns=2;s=Name" text form.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <opc/ua/protocol/types.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace OpcUa
+{
+
+  // Parses "[ns=<index>;|nsu=<uri>;](i=|s=|g=|b=)<identifier>".
+  // Namespace URIs found in the table are replaced by their index, others are kept in the NodeID.
+  class NodeIDParser
+  {
+  public:
+    explicit NodeIDParser(const std::vector<std::string>& namespaceURIs = std::vector<std::string>());
+
+    NodeID Parse(const std::string& text) const;
+    std::vector<NodeID> Parse(const std::vector<std::string>& texts) const;
+
+  private:
+    std::unordered_map<std::string, uint16_t> Namespaces;
+  };
+
+  std::string FormatNodeID(const NodeID& id);
+  std::vector<std::string> FormatNodeIDs(const std::vector<NodeID>& ids);
+
+}
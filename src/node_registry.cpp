@@ -0,0 +1,126 @@
+/// @brief Nodes registered once in this process for repeated reads and writes through short aliases.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "node_registry.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace OpcUa
+{
+
+  std::vector<uint64_t> NodeRegistry::Add(const std::vector<NodeID>& nodes)
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    const std::size_t added = nodes.size() > FreeSlots.size() ? nodes.size() - FreeSlots.size() : 0;
+    if (added > std::numeric_limits<uint32_t>::max() - Entries.size())
+    {
+      throw std::logic_error("Too many registered nodes.");
+    }
+    std::vector<uint64_t> aliases(nodes.size());
+    Entries.reserve(Entries.size() + added);
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+      uint32_t slot = 0;
+      if (FreeSlots.empty())
+      {
+        slot = static_cast<uint32_t>(Entries.size());
+        Entry entry;
+        entry.Registered = false;
+        entry.Generation = 0;
+        Entries.push_back(std::move(entry));
+      }
+      else
+      {
+        slot = FreeSlots.back();
+        FreeSlots.pop_back();
+      }
+      Entry& entry = Entries[slot];
+      entry.Registered = true;
+      entry.Value.Node = nodes[i];
+      entry.Value.Attribute = AttributeID::VALUE;
+      aliases[i] = static_cast<uint64_t>(entry.Generation) << 32 | slot;
+    }
+    Size += nodes.size();
+    return aliases;
+  }
+
+  void NodeRegistry::Remove(const std::vector<uint64_t>& aliases)
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    for (uint64_t alias : aliases)
+    {
+      const uint32_t slot = static_cast<uint32_t>(alias);
+      if (slot < Entries.size() && Entries[slot].Registered && Entries[slot].Generation == alias >> 32)
+      {
+        Entries[slot].Registered = false;
+        Entries[slot].Value = AttributeValueID();
+        // A slot whose generation would wrap around is retired, so no old alias can match it again.
+        if (++Entries[slot].Generation != 0)
+        {
+          FreeSlots.push_back(slot);
+        }
+        --Size;
+      }
+    }
+  }
+
+  const NodeRegistry::Entry& NodeRegistry::Find(uint64_t alias) const
+  {
+    const uint32_t slot = static_cast<uint32_t>(alias);
+    if (slot >= Entries.size() || !Entries[slot].Registered || Entries[slot].Generation != alias >> 32)
+    {
+      throw std::logic_error("Node is not registered.");
+    }
+    return Entries[slot];
+  }
+
+  NodeID NodeRegistry::GetNode(uint64_t alias) const
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    return Find(alias).Value.Node;
+  }
+
+  ReadParameters NodeRegistry::GetReadParameters(const std::vector<uint64_t>& aliases) const
+  {
+    ReadParameters params;
+    params.TimestampsType = TimestampsToReturn::BOTH;
+    params.AttributesToRead.reserve(aliases.size());
+    std::unique_lock<std::mutex> lock(Mutex);
+    for (uint64_t alias : aliases)
+    {
+      params.AttributesToRead.push_back(Find(alias).Value);
+    }
+    return params;
+  }
+
+  std::vector<WriteValue> NodeRegistry::GetWriteValues(const std::vector<uint64_t>& aliases, const std::vector<Variant>& values) const
+  {
+    if (aliases.size() != values.size())
+    {
+      throw std::logic_error("Expected one value per registered node.");
+    }
+    std::vector<WriteValue> result(aliases.size());
+    std::unique_lock<std::mutex> lock(Mutex);
+    for (std::size_t i = 0; i < aliases.size(); ++i)
+    {
+      result[i].Node = Find(aliases[i]).Value.Node;
+      result[i].Attribute = AttributeID::VALUE;
+      result[i].Data.Value = values[i];
+      result[i].Data.Encoding = DATA_VALUE;
+    }
+    return result;
+  }
+
+  std::size_t NodeRegistry::GetSize() const
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    return Size;
+  }
+
+}
@@ -0,0 +1,55 @@
+/// @brief Nodes registered once in this process for repeated reads and writes through short aliases.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <opc/ua/protocol/types.h>
+
+#include <mutex>
+#include <vector>
+
+namespace OpcUa
+{
+
+  // An alias holds the position of the node in a table in its low 32 bits, so finding a registered node
+  // costs one index instead of parsing and comparing its NodeID. Aliases are local to this process:
+  // requests still carry the full NodeID, the server never sees them.
+  // Slots are reused after Remove. The high 32 bits hold the generation of the slot, so a stale alias
+  // is refused instead of reaching the node registered later in the same slot.
+  class NodeRegistry
+  {
+  public:
+    std::vector<uint64_t> Add(const std::vector<NodeID>& nodes);
+    void Remove(const std::vector<uint64_t>& aliases);
+
+    // Throw std::logic_error for an alias that is not registered.
+    NodeID GetNode(uint64_t alias) const;
+    ReadParameters GetReadParameters(const std::vector<uint64_t>& aliases) const;
+    std::vector<WriteValue> GetWriteValues(const std::vector<uint64_t>& aliases, const std::vector<Variant>& values) const;
+
+    std::size_t GetSize() const;
+
+  private:
+    struct Entry
+    {
+      bool Registered;
+      uint32_t Generation;
+      // Prepared once, a read only copies it.
+      AttributeValueID Value;
+    };
+
+    const Entry& Find(uint64_t alias) const;
+
+  private:
+    mutable std::mutex Mutex;
+    std::vector<Entry> Entries;
+    std::vector<uint32_t> FreeSlots;
+    std::size_t Size = 0;
+  };
+
+}
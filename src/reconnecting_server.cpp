@@ -0,0 +1,372 @@
+/// @brief Client connection which survives network failures.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "reconnecting_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <stdexcept>
+
+namespace
+{
+  using namespace OpcUa;
+
+  struct EndpointCache
+  {
+    std::mutex Mutex;
+    std::map<std::string, std::vector<EndpointDescription>> Endpoints;
+  };
+
+  EndpointCache& GetEndpointCache()
+  {
+    static EndpointCache cache;
+    return cache;
+  }
+
+  double MillisecondsSince(std::chrono::steady_clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+namespace OpcUa
+{
+
+  std::vector<EndpointDescription> GetCachedEndpoints(Remote::Server& server, const std::string& url)
+  {
+    EndpointCache& cache = GetEndpointCache();
+    {
+      std::unique_lock<std::mutex> lock(cache.Mutex);
+      auto it = cache.Endpoints.find(url);
+      if (it != cache.Endpoints.end())
+      {
+        return it->second;
+      }
+    }
+    EndpointsFilter filter;
+    filter.EndpointURL = url;
+    const std::vector<EndpointDescription> endpoints = server.Endpoints()->GetEndpoints(filter);
+    if (!endpoints.empty())
+    {
+      std::unique_lock<std::mutex> lock(cache.Mutex);
+      cache.Endpoints[url] = endpoints;
+    }
+    return endpoints;
+  }
+
+  void ClearEndpointCache()
+  {
+    EndpointCache& cache = GetEndpointCache();
+    std::unique_lock<std::mutex> lock(cache.Mutex);
+    cache.Endpoints.clear();
+  }
+
+  ReconnectingServer::ReconnectingServer(const std::string& url, const Remote::SessionParameters& session)
+    : Url(url)
+    , Session(session)
+    , Closed(false)
+    , AutoReconnect(false)
+    , Random(std::random_device()())
+  {
+    Stats.Connected = false;
+    Stats.Reconnects = 0;
+    Stats.SessionsReused = 0;
+    Stats.FailedAttempts = 0;
+    Stats.LastReconnectMs = 0;
+    Stats.MaxReconnectMs = 0;
+    Stats.TotalReconnectMs = 0;
+  }
+
+  ReconnectingServer::~ReconnectingServer()
+  {
+    DisableAutoReconnect();
+  }
+
+  void ReconnectingServer::Connect()
+  {
+    std::unique_lock<std::mutex> reconnectLock(ReconnectMutex);
+    Remote::Server::SharedPtr connection = OpenSession();
+    {
+      std::unique_lock<std::mutex> lock(ConnectionMutex);
+      Connection = connection;
+      Closed = false;
+    }
+    std::unique_lock<std::mutex> lock(StateMutex);
+    Stats.Connected = true;
+  }
+
+  Remote::Server::SharedPtr ReconnectingServer::OpenSession()
+  {
+    Remote::SessionParameters session;
+    {
+      std::unique_lock<std::mutex> lock(StateMutex);
+      session = Session;
+    }
+    Remote::Server::SharedPtr connection = Remote::Connect(Url);
+    if (session.ServerURI.empty())
+    {
+      const std::vector<EndpointDescription> endpoints = GetCachedEndpoints(*connection, Url);
+      if (!endpoints.empty())
+      {
+        session.ServerURI = endpoints.front().ServerDescription.URI;
+      }
+    }
+    connection->CreateSession(session);
+    connection->ActivateSession();
+    return connection;
+  }
+
+  bool ReconnectingServer::Reconnect()
+  {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> reconnectLock(ReconnectMutex);
+    {
+      std::unique_lock<std::mutex> lock(ConnectionMutex);
+      if (Closed || !Connection)
+      {
+        return false;
+      }
+    }
+    {
+      std::unique_lock<std::mutex> lock(StateMutex);
+      Stats.Connected = false;
+    }
+
+    unsigned delay = 0;
+    for (;;)
+    {
+      if (TryReconnect())
+      {
+        break;
+      }
+      std::unique_lock<std::mutex> lock(StateMutex);
+      ++Stats.FailedAttempts;
+      if (!AutoReconnect)
+      {
+        return false;
+      }
+      delay = delay ? std::min(delay * 2, Policy.MaxDelayMs) : Policy.MinDelayMs;
+      // Clients that lost the server together should not come back together.
+      std::uniform_int_distribution<unsigned> jitter(delay / 2, delay);
+      StateCondition.wait_for(lock, std::chrono::milliseconds(jitter(Random)), [this](){ return !AutoReconnect; });
+      if (!AutoReconnect)
+      {
+        return false;
+      }
+    }
+
+    const double latency = MillisecondsSince(start);
+    std::unique_lock<std::mutex> lock(StateMutex);
+    Stats.Connected = true;
+    ++Stats.Reconnects;
+    Stats.LastReconnectMs = latency;
+    Stats.MaxReconnectMs = std::max(Stats.MaxReconnectMs, latency);
+    Stats.TotalReconnectMs += latency;
+    return true;
+  }
+
+  bool ReconnectingServer::TryReconnect()
+  {
+    Remote::Server::SharedPtr old;
+    {
+      std::unique_lock<std::mutex> lock(ConnectionMutex);
+      if (Closed)
+      {
+        return false;
+      }
+      old = Connection;
+    }
+
+    // The channel may have survived while the session did not, activating it again is one round trip.
+    try
+    {
+      old->ActivateSession();
+      if (IsAlive(*old))
+      {
+        std::unique_lock<std::mutex> lock(StateMutex);
+        ++Stats.SessionsReused;
+        return true;
+      }
+    }
+    catch (const std::exception&)
+    {
+    }
+
+    Remote::Server::SharedPtr connection;
+    try
+    {
+      connection = OpenSession();
+    }
+    catch (const std::exception&)
+    {
+      return false;
+    }
+    std::unique_lock<std::mutex> lock(ConnectionMutex);
+    if (!Closed)
+    {
+      Connection = connection;
+    }
+    return true;
+  }
+
+  bool ReconnectingServer::IsAlive(Remote::Server& connection) const
+  {
+    ReadParameters params;
+    params.TimestampsType = TimestampsToReturn::NEITHER;
+    params.AttributesToRead.resize(1);
+    params.AttributesToRead[0].Node = NodeID(ObjectID::Server);
+    params.AttributesToRead[0].Attribute = AttributeID::NODE_CLASS;
+    try
+    {
+      const std::vector<DataValue> result = connection.Attributes()->Read(params);
+      return !result.empty() && result[0].Status == StatusCode::Good;
+    }
+    catch (const std::exception&)
+    {
+      return false;
+    }
+  }
+
+  void ReconnectingServer::EnableAutoReconnect(const ReconnectPolicy& policy)
+  {
+    DisableAutoReconnect();
+    {
+      std::unique_lock<std::mutex> lock(StateMutex);
+      Policy = policy;
+      Policy.CheckIntervalMs = std::max(Policy.CheckIntervalMs, 1u);
+      Policy.MinDelayMs = std::max(Policy.MinDelayMs, 1u);
+      Policy.MaxDelayMs = std::max(Policy.MaxDelayMs, Policy.MinDelayMs);
+      AutoReconnect = true;
+    }
+    Watcher = std::thread([this](){ Watch(); });
+  }
+
+  void ReconnectingServer::DisableAutoReconnect()
+  {
+    {
+      std::unique_lock<std::mutex> lock(StateMutex);
+      AutoReconnect = false;
+    }
+    StateCondition.notify_all();
+    if (Watcher.joinable())
+    {
+      Watcher.join();
+    }
+  }
+
+  void ReconnectingServer::Watch()
+  {
+    std::unique_lock<std::mutex> lock(StateMutex);
+    for (;;)
+    {
+      StateCondition.wait_for(lock, std::chrono::milliseconds(Policy.CheckIntervalMs), [this](){ return !AutoReconnect; });
+      if (!AutoReconnect)
+      {
+        return;
+      }
+      lock.unlock();
+      Remote::Server::SharedPtr connection;
+      {
+        std::unique_lock<std::mutex> connectionLock(ConnectionMutex);
+        connection = Closed ? Remote::Server::SharedPtr() : Connection;
+      }
+      if (connection && !IsAlive(*connection))
+      {
+        Reconnect();
+      }
+      lock.lock();
+    }
+  }
+
+  std::vector<EndpointDescription> ReconnectingServer::GetEndpoints()
+  {
+    return GetCachedEndpoints(*GetConnection(), Url);
+  }
+
+  std::vector<ApplicationDescription> ReconnectingServer::FindServers()
+  {
+    FindServersParameters params;
+    params.EndpointURL = Url;
+    return GetConnection()->Endpoints()->FindServers(params);
+  }
+
+  ConnectionStats ReconnectingServer::GetStats() const
+  {
+    std::unique_lock<std::mutex> lock(StateMutex);
+    return Stats;
+  }
+
+  Remote::Server::SharedPtr ReconnectingServer::GetConnection() const
+  {
+    std::unique_lock<std::mutex> lock(ConnectionMutex);
+    if (!Connection || Closed)
+    {
+      throw std::logic_error("Client is not connected.");
+    }
+    return Connection;
+  }
+
+  void ReconnectingServer::CreateSession(const Remote::SessionParameters& parameters)
+  {
+    {
+      std::unique_lock<std::mutex> lock(StateMutex);
+      Session = parameters;
+    }
+    GetConnection()->CreateSession(parameters);
+  }
+
+  void ReconnectingServer::ActivateSession()
+  {
+    GetConnection()->ActivateSession();
+  }
+
+  void ReconnectingServer::CloseSession()
+  {
+    DisableAutoReconnect();
+    Remote::Server::SharedPtr connection;
+    {
+      std::unique_lock<std::mutex> lock(ConnectionMutex);
+      if (Closed)
+      {
+        return;
+      }
+      Closed = true;
+      connection.swap(Connection);
+    }
+    {
+      std::unique_lock<std::mutex> lock(StateMutex);
+      Stats.Connected = false;
+    }
+    if (connection)
+    {
+      connection->CloseSession();
+    }
+  }
+
+  Remote::EndpointServices::SharedPtr ReconnectingServer::Endpoints() const
+  {
+    return GetConnection()->Endpoints();
+  }
+
+  Remote::ViewServices::SharedPtr ReconnectingServer::Views() const
+  {
+    return GetConnection()->Views();
+  }
+
+  Remote::AttributeServices::SharedPtr ReconnectingServer::Attributes() const
+  {
+    return GetConnection()->Attributes();
+  }
+
+  Remote::NodeManagementServices::SharedPtr ReconnectingServer::NodeManagement() const
+  {
+    return GetConnection()->NodeManagement();
+  }
+
+}
@@ -0,0 +1,115 @@
+/// @brief Client connection which survives network failures.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <opc/ua/server.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace OpcUa
+{
+
+  struct ReconnectPolicy
+  {
+    unsigned CheckIntervalMs; // How often the connection is probed.
+    unsigned MinDelayMs;      // First delay between failed attempts, doubled up to MaxDelayMs.
+    unsigned MaxDelayMs;
+
+    ReconnectPolicy()
+      : CheckIntervalMs(1000)
+      , MinDelayMs(100)
+      , MaxDelayMs(10000)
+    {
+    }
+  };
+
+  struct ConnectionStats
+  {
+    bool Connected;
+    uint64_t Reconnects;
+    uint64_t SessionsReused; // Reconnects which only had to activate the old session again.
+    uint64_t FailedAttempts;
+    double LastReconnectMs;  // From the detected failure to a working session.
+    double MaxReconnectMs;
+    double TotalReconnectMs;
+  };
+
+  // Discovered endpoints are kept for the whole process so that
+  // reconnecting clients do not ask the server for them again.
+  std::vector<EndpointDescription> GetCachedEndpoints(Remote::Server& server, const std::string& url);
+  void ClearEndpointCache();
+
+  // Forwards every service to the current connection and replaces it when it breaks.
+  // Nodes keep pointing to this object, so they stay usable after a reconnect.
+  class ReconnectingServer : public Remote::Server
+  {
+  public:
+    ReconnectingServer(const std::string& url, const Remote::SessionParameters& session);
+    ~ReconnectingServer();
+
+    ReconnectingServer(const ReconnectingServer&) = delete;
+    ReconnectingServer& operator=(const ReconnectingServer&) = delete;
+
+    // Open the first connection, errors are thrown.
+    void Connect();
+    // Activate the session again or replace the connection. With auto reconnect enabled
+    // failed attempts are retried with backoff until one works or it is disabled.
+    // Returns false when it gave up.
+    bool Reconnect();
+
+    void EnableAutoReconnect(const ReconnectPolicy& policy);
+    void DisableAutoReconnect();
+
+    std::vector<EndpointDescription> GetEndpoints();
+    std::vector<ApplicationDescription> FindServers();
+    ConnectionStats GetStats() const;
+
+    virtual void CreateSession(const Remote::SessionParameters& parameters);
+    virtual void ActivateSession();
+    virtual void CloseSession();
+
+    virtual Remote::EndpointServices::SharedPtr Endpoints() const;
+    virtual Remote::ViewServices::SharedPtr Views() const;
+    virtual Remote::AttributeServices::SharedPtr Attributes() const;
+    virtual Remote::NodeManagementServices::SharedPtr NodeManagement() const;
+
+  private:
+    Remote::Server::SharedPtr GetConnection() const;
+    Remote::Server::SharedPtr OpenSession();
+    bool TryReconnect();
+    bool IsAlive(Remote::Server& connection) const;
+    unsigned NextDelay(unsigned delay);
+    void Watch();
+
+  private:
+    const std::string Url;
+    Remote::SessionParameters Session;
+
+    mutable std::mutex ConnectionMutex;
+    Remote::Server::SharedPtr Connection;
+    bool Closed;
+
+    // Only one reconnect runs at a time.
+    std::mutex ReconnectMutex;
+
+    mutable std::mutex StateMutex;
+    std::condition_variable StateCondition;
+    ReconnectPolicy Policy;
+    bool AutoReconnect;
+    ConnectionStats Stats;
+    std::mt19937 Random;
+
+    std::thread Watcher;
+  };
+
+}
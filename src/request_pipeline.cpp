@@ -0,0 +1,239 @@
+/// @brief Splits large service requests into chunks, sent one after another or from several threads.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "request_pipeline.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace OpcUa
+{
+
+  RequestPipeline::RequestPipeline(Remote::Server::SharedPtr server, unsigned window, std::size_t chunkSize)
+    : Server(server)
+    , Window(window ? window : 1)
+    , ChunkSize(chunkSize ? chunkSize : 1)
+    , Stopping(false)
+    , Requests(0)
+    , Chunks(0)
+    , InFlight(0)
+    , MaxInFlight(0)
+  {
+    for (unsigned i = 0; Window > 1 && i < Window; ++i)
+    {
+      Workers.push_back(std::thread([this](){ Work(); }));
+    }
+  }
+
+  RequestPipeline::~RequestPipeline()
+  {
+    {
+      std::unique_lock<std::mutex> lock(TasksMutex);
+      Stopping = true;
+    }
+    TasksCondition.notify_all();
+    for (std::thread& worker : Workers)
+    {
+      worker.join();
+    }
+  }
+
+  unsigned RequestPipeline::GetWindow() const
+  {
+    return Window;
+  }
+
+  std::size_t RequestPipeline::GetChunkSize() const
+  {
+    return ChunkSize;
+  }
+
+  RequestPipelineStats RequestPipeline::GetStats() const
+  {
+    RequestPipelineStats stats;
+    stats.Requests = Requests;
+    stats.Chunks = Chunks;
+    stats.MaxInFlight = MaxInFlight;
+    return stats;
+  }
+
+  std::vector<DataValue> RequestPipeline::Read(const ReadParameters& params)
+  {
+    const std::vector<AttributeValueID>& attributes = params.AttributesToRead;
+    if (attributes.size() <= ChunkSize)
+    {
+      ++Requests;
+      ++Chunks;
+      return Server->Attributes()->Read(params);
+    }
+
+    const std::size_t count = (attributes.size() + ChunkSize - 1) / ChunkSize;
+    std::vector<std::vector<DataValue>> results(count);
+    Run(count, [&](std::size_t chunk)
+      {
+        ReadParameters part;
+        part.MaxAge = params.MaxAge;
+        part.TimestampsType = params.TimestampsType;
+        const std::size_t begin = chunk * ChunkSize;
+        const std::size_t end = std::min(begin + ChunkSize, attributes.size());
+        part.AttributesToRead.assign(attributes.begin() + begin, attributes.begin() + end);
+        results[chunk] = Server->Attributes()->Read(part);
+      });
+
+    std::vector<DataValue> result;
+    result.reserve(attributes.size());
+    for (const std::vector<DataValue>& part : results)
+    {
+      result.insert(result.end(), part.begin(), part.end());
+    }
+    return result;
+  }
+
+  std::vector<StatusCode> RequestPipeline::Write(const std::vector<WriteValue>& values)
+  {
+    if (values.size() <= ChunkSize)
+    {
+      ++Requests;
+      ++Chunks;
+      return Server->Attributes()->Write(values);
+    }
+
+    const std::size_t count = (values.size() + ChunkSize - 1) / ChunkSize;
+    std::vector<std::vector<StatusCode>> results(count);
+    Run(count, [&](std::size_t chunk)
+      {
+        const std::size_t begin = chunk * ChunkSize;
+        const std::size_t end = std::min(begin + ChunkSize, values.size());
+        results[chunk] = Server->Attributes()->Write(std::vector<WriteValue>(values.begin() + begin, values.begin() + end));
+      });
+
+    std::vector<StatusCode> result;
+    result.reserve(values.size());
+    for (const std::vector<StatusCode>& part : results)
+    {
+      result.insert(result.end(), part.begin(), part.end());
+    }
+    return result;
+  }
+
+  std::vector<BrowsePathResult> RequestPipeline::TranslateBrowsePaths(const std::vector<BrowsePath>& paths)
+  {
+    if (paths.size() <= ChunkSize)
+    {
+      ++Requests;
+      ++Chunks;
+      TranslateBrowsePathsParameters params;
+      params.BrowsePaths = paths;
+      return Server->Views()->TranslateBrowsePathsToNodeIds(params);
+    }
+
+    const std::size_t count = (paths.size() + ChunkSize - 1) / ChunkSize;
+    std::vector<std::vector<BrowsePathResult>> results(count);
+    Run(count, [&](std::size_t chunk)
+      {
+        TranslateBrowsePathsParameters part;
+        const std::size_t begin = chunk * ChunkSize;
+        const std::size_t end = std::min(begin + ChunkSize, paths.size());
+        part.BrowsePaths.assign(paths.begin() + begin, paths.begin() + end);
+        results[chunk] = Server->Views()->TranslateBrowsePathsToNodeIds(part);
+      });
+
+    std::vector<BrowsePathResult> result;
+    result.reserve(paths.size());
+    for (const std::vector<BrowsePathResult>& part : results)
+    {
+      result.insert(result.end(), part.begin(), part.end());
+    }
+    return result;
+  }
+
+  void RequestPipeline::Run(std::size_t count, const std::function<void (std::size_t)>& task)
+  {
+    if (Workers.empty())
+    {
+      ++Requests;
+      MaxInFlight = 1;
+      for (std::size_t chunk = 0; chunk < count; ++chunk)
+      {
+        ++Chunks;
+        task(chunk);
+      }
+      return;
+    }
+
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    std::size_t remaining = count;
+    std::exception_ptr failure;
+
+    ++Requests;
+    {
+      std::unique_lock<std::mutex> lock(TasksMutex);
+      for (std::size_t chunk = 0; chunk < count; ++chunk)
+      {
+        Tasks.push_back([&, chunk]()
+          {
+            std::exception_ptr error;
+            try
+            {
+              task(chunk);
+            }
+            catch (...)
+            {
+              error = std::current_exception();
+            }
+            std::unique_lock<std::mutex> doneLock(doneMutex);
+            if (error && !failure)
+            {
+              failure = error;
+            }
+            if (--remaining == 0)
+            {
+              doneCondition.notify_all();
+            }
+          });
+      }
+    }
+    TasksCondition.notify_all();
+
+    std::unique_lock<std::mutex> lock(doneMutex);
+    doneCondition.wait(lock, [&](){ return remaining == 0; });
+    if (failure)
+    {
+      std::rethrow_exception(failure);
+    }
+  }
+
+  void RequestPipeline::Work()
+  {
+    for (;;)
+    {
+      Task task;
+      {
+        std::unique_lock<std::mutex> lock(TasksMutex);
+        TasksCondition.wait(lock, [this](){ return Stopping || !Tasks.empty(); });
+        if (Tasks.empty())
+        {
+          return;
+        }
+        task.swap(Tasks.front());
+        Tasks.pop_front();
+      }
+
+      const unsigned inFlight = ++InFlight;
+      unsigned maxInFlight = MaxInFlight;
+      while (inFlight > maxInFlight && !MaxInFlight.compare_exchange_weak(maxInFlight, inFlight))
+      {
+      }
+      ++Chunks;
+      task();
+      --InFlight;
+    }
+  }
+
+}
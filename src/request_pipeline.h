@@ -0,0 +1,79 @@
+/// @brief Splits large service requests into chunks, sent one after another or from several threads.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <opc/ua/server.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OpcUa
+{
+
+  struct RequestPipelineStats
+  {
+    uint64_t Requests;
+    uint64_t Chunks;
+    unsigned MaxInFlight;
+  };
+
+  // Splits large Read, Write and TranslateBrowsePaths calls into chunks of at most ChunkSize items.
+  // Results are put back in request order by chunk position.
+  // With a window of 1 the chunks are sent one after another from the calling thread. A larger window calls
+  // the server from that many threads at once, which needs a Remote::Server safe for concurrent calls:
+  // the in-process server is, a client connection is not known to be and only ever gets a window of 1.
+  class RequestPipeline
+  {
+  public:
+    RequestPipeline(Remote::Server::SharedPtr server, unsigned window, std::size_t chunkSize);
+    ~RequestPipeline();
+
+    RequestPipeline(const RequestPipeline&) = delete;
+    RequestPipeline& operator=(const RequestPipeline&) = delete;
+
+    std::vector<DataValue> Read(const ReadParameters& params);
+    std::vector<StatusCode> Write(const std::vector<WriteValue>& values);
+    std::vector<BrowsePathResult> TranslateBrowsePaths(const std::vector<BrowsePath>& paths);
+
+    unsigned GetWindow() const;
+    std::size_t GetChunkSize() const;
+    RequestPipelineStats GetStats() const;
+
+  private:
+    typedef std::function<void ()> Task;
+
+    // Runs count tasks on the workers, or in order on the calling thread without workers,
+    // and waits for all of them; rethrows the first failure.
+    void Run(std::size_t count, const std::function<void (std::size_t)>& task);
+    void Work();
+
+  private:
+    const Remote::Server::SharedPtr Server;
+    const unsigned Window;
+    const std::size_t ChunkSize;
+
+    std::mutex TasksMutex;
+    std::condition_variable TasksCondition;
+    std::deque<Task> Tasks;
+    bool Stopping;
+
+    std::atomic<uint64_t> Requests;
+    std::atomic<uint64_t> Chunks;
+    std::atomic<unsigned> InFlight;
+    std::atomic<unsigned> MaxInFlight;
+
+    std::vector<std::thread> Workers;
+  };
+
+}
@@ -0,0 +1,670 @@
+/// @brief Sampling of monitored items driven by a timer wheel.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "sampling_engine.h"
+#include "variant_numeric.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+  template <typename T>
+  void SwapRemove(std::vector<T>& values, std::size_t index)
+  {
+    values[index] = values.back();
+    values.pop_back();
+  }
+
+  uint64_t GetRandomSeed()
+  {
+    std::random_device device;
+    return (static_cast<uint64_t>(device()) << 32) | device();
+  }
+
+  // 16 bytes: the random base of the engine and a counter.
+  OpcUa::ByteString MakeEventID(uint64_t base, uint64_t counter)
+  {
+    std::vector<uint8_t> data(16);
+    for (unsigned i = 0; i < 8; ++i)
+    {
+      data[i] = static_cast<uint8_t>(base >> (56 - 8 * i));
+      data[8 + i] = static_cast<uint8_t>(counter >> (56 - 8 * i));
+    }
+    return OpcUa::ByteString(data);
+  }
+
+  // Where an event item takes a field from.
+  enum class FieldSource
+  {
+    Column,
+    EventID,
+    EventType,
+    SourceNode,
+    Time,
+    ReceiveTime,
+    None,
+  };
+}
+
+namespace OpcUa
+{
+
+  SamplingEngine::SamplingEngine(Remote::Server::SharedPtr server, unsigned tickMs, std::size_t batchSize)
+    : Server(server)
+    , TickMs(tickMs ? tickMs : 1)
+    , BatchSize(batchSize ? batchSize : 1)
+    , NextItemID(1)
+    , NextSubscriptionID(1)
+    , EventIDBase(GetRandomSeed())
+    , NextEventID(0)
+    , Stopping(false)
+    , Samples(0)
+    , Notifications(0)
+    , Events(0)
+    , Overflows(0)
+    , LateTicks(0)
+    , ReadErrors(0)
+    , CallbackErrors(0)
+  {
+  }
+
+  SamplingEngine::~SamplingEngine()
+  {
+    Stop();
+  }
+
+  void SamplingEngine::Start()
+  {
+    if (Thread.joinable())
+    {
+      return;
+    }
+    Stopping = false;
+    Thread = std::thread([this](){ Run(); });
+  }
+
+  void SamplingEngine::Stop()
+  {
+    Stopping = true;
+    if (Thread.joinable())
+    {
+      Thread.join();
+    }
+  }
+
+  uint32_t SamplingEngine::CreateSubscription(std::size_t queueSize)
+  {
+    std::unique_lock<std::mutex> lock(QueuesMutex);
+    const uint32_t id = NextSubscriptionID++;
+    Subscriptions[id].MaxSize = queueSize ? queueSize : 1;
+    return id;
+  }
+
+  uint32_t SamplingEngine::CreateSubscription(NotificationCallback callback)
+  {
+    std::unique_lock<std::mutex> lock(QueuesMutex);
+    const uint32_t id = NextSubscriptionID++;
+    Subscriptions[id].MaxSize = 0;
+    Subscriptions[id].Callback = callback;
+    return id;
+  }
+
+  void SamplingEngine::DeleteSubscription(uint32_t subscriptionID)
+  {
+    std::vector<uint32_t> items;
+    {
+      std::unique_lock<std::mutex> lock(ItemsMutex);
+      for (const std::pair<const unsigned, Group>& group : Groups)
+      {
+        for (std::size_t i = 0; i < group.second.Items.size(); ++i)
+        {
+          if (group.second.Subscriptions[i] == subscriptionID)
+          {
+            items.push_back(group.second.Items[i]);
+          }
+        }
+      }
+      for (const std::pair<const uint32_t, EventItem>& item : EventItems)
+      {
+        if (item.second.SubscriptionID == subscriptionID)
+        {
+          items.push_back(item.first);
+        }
+      }
+    }
+    for (uint32_t item : items)
+    {
+      RemoveItem(item);
+    }
+    std::unique_lock<std::mutex> lock(QueuesMutex);
+    Subscriptions.erase(subscriptionID);
+    QueuesCondition.notify_all();
+  }
+
+  uint32_t SamplingEngine::AddItem(const MonitoredItemParameters& params)
+  {
+    {
+      std::unique_lock<std::mutex> lock(QueuesMutex);
+      if (!Subscriptions.count(params.SubscriptionID))
+      {
+        throw std::logic_error("Unknown subscription.");
+      }
+    }
+
+    double threshold = 0;
+    switch (params.Deadband)
+    {
+      case DeadbandType::None:
+        break;
+      case DeadbandType::Absolute:
+        threshold = params.DeadbandValue;
+        break;
+      case DeadbandType::Percent:
+        threshold = params.DeadbandValue / 100 * std::fabs(params.RangeHigh - params.RangeLow);
+        break;
+      default:
+        throw std::logic_error("Invalid deadband type.");
+    }
+
+    const unsigned interval = ToTicks(params.SamplingInterval);
+    std::unique_lock<std::mutex> lock(ItemsMutex);
+    std::map<unsigned, Group>::iterator groupIt = Groups.find(interval);
+    if (groupIt == Groups.end())
+    {
+      groupIt = Groups.insert(std::make_pair(interval, Group())).first;
+      groupIt->second.Interval = interval;
+      Wheel.Schedule(interval, Wheel.GetNow() + interval);
+    }
+    Group& group = groupIt->second;
+    const uint32_t id = NextItemID++;
+    group.Items.push_back(id);
+    group.Subscriptions.push_back(params.SubscriptionID);
+    group.Nodes.push_back(params.Node);
+    group.Deadbands.push_back(params.Deadband);
+    group.Thresholds.push_back(threshold);
+    group.LastNumbers.push_back(0);
+    group.LastStatuses.push_back(0);
+    group.Sampled.push_back(false);
+
+    ItemLocation location;
+    location.Interval = interval;
+    location.Index = group.Items.size() - 1;
+    Locations[id] = location;
+    return id;
+  }
+
+  uint32_t SamplingEngine::AddEventItem(uint32_t subscriptionID, const NodeID& notifier, const std::vector<std::string>& fields)
+  {
+    {
+      std::unique_lock<std::mutex> lock(QueuesMutex);
+      std::map<uint32_t, Subscription>::const_iterator it = Subscriptions.find(subscriptionID);
+      if (it == Subscriptions.end())
+      {
+        throw std::logic_error("Unknown subscription.");
+      }
+      if (it->second.Callback)
+      {
+        throw std::logic_error("Events are only queued, the subscription has a callback.");
+      }
+    }
+    EventItem item;
+    item.SubscriptionID = subscriptionID;
+    item.Notifier = notifier;
+    item.Fields = fields;
+    std::unique_lock<std::mutex> lock(ItemsMutex);
+    const uint32_t id = NextItemID++;
+    EventItems[id] = item;
+    return id;
+  }
+
+  void SamplingEngine::RemoveItem(uint32_t itemID)
+  {
+    std::unique_lock<std::mutex> lock(ItemsMutex);
+    if (EventItems.erase(itemID))
+    {
+      return;
+    }
+    std::unordered_map<uint32_t, ItemLocation>::iterator locationIt = Locations.find(itemID);
+    if (locationIt == Locations.end())
+    {
+      throw std::logic_error("Unknown monitored item.");
+    }
+    Group& group = Groups[locationIt->second.Interval];
+    const std::size_t index = locationIt->second.Index;
+    Locations.erase(locationIt);
+    group.LastValues.erase(itemID);
+
+    // Empty groups stay until their timer fires, so the wheel never holds a stale timer.
+    SwapRemove(group.Items, index);
+    SwapRemove(group.Subscriptions, index);
+    SwapRemove(group.Nodes, index);
+    SwapRemove(group.Deadbands, index);
+    SwapRemove(group.Thresholds, index);
+    SwapRemove(group.LastNumbers, index);
+    SwapRemove(group.LastStatuses, index);
+    group.Sampled[index] = group.Sampled.back();
+    group.Sampled.pop_back();
+    if (index < group.Items.size())
+    {
+      Locations[group.Items[index]].Index = index;
+    }
+  }
+
+  std::vector<MonitoredItemNotification> SamplingEngine::Publish(uint32_t subscriptionID, std::size_t maxCount, unsigned waitMs)
+  {
+    std::unique_lock<std::mutex> lock(QueuesMutex);
+    std::map<uint32_t, Subscription>::iterator it = Subscriptions.find(subscriptionID);
+    if (it == Subscriptions.end())
+    {
+      throw std::logic_error("Unknown subscription.");
+    }
+    if (waitMs && it->second.Queue.empty())
+    {
+      QueuesCondition.wait_for(lock, std::chrono::milliseconds(waitMs), [this, subscriptionID]()
+        {
+          std::map<uint32_t, Subscription>::const_iterator sub = Subscriptions.find(subscriptionID);
+          return sub == Subscriptions.end() || !sub->second.Queue.empty();
+        });
+      it = Subscriptions.find(subscriptionID);
+      if (it == Subscriptions.end())
+      {
+        throw std::logic_error("Subscription was deleted.");
+      }
+    }
+    std::deque<MonitoredItemNotification>& queue = it->second.Queue;
+    const std::size_t count = maxCount ? std::min(maxCount, queue.size()) : queue.size();
+    std::vector<MonitoredItemNotification> result(queue.begin(), queue.begin() + count);
+    queue.erase(queue.begin(), queue.begin() + count);
+    return result;
+  }
+
+  void SamplingEngine::FireEvents(const EventBatch& batch)
+  {
+    if (batch.Columns.size() != batch.Fields.size())
+    {
+      throw std::logic_error("Event batch has a different number of fields and columns.");
+    }
+    for (const std::vector<Variant>& column : batch.Columns)
+    {
+      if (column.size() != batch.Count)
+      {
+        throw std::logic_error("Event batch columns have different lengths.");
+      }
+    }
+    if (!batch.Count)
+    {
+      return;
+    }
+
+    // Sources of the selected fields, resolved once per item and batch.
+    std::vector<std::pair<uint32_t, EventItem>> items;
+    std::vector<std::vector<std::pair<FieldSource, std::size_t>>> sources;
+    {
+      std::unique_lock<std::mutex> lock(ItemsMutex);
+      const NodeID server(ObjectID::Server);
+      for (const std::pair<const uint32_t, EventItem>& item : EventItems)
+      {
+        if (item.second.Notifier == batch.Source || item.second.Notifier == server)
+        {
+          items.push_back(item);
+        }
+      }
+    }
+    Events += batch.Count;
+    if (items.empty())
+    {
+      return;
+    }
+    for (const std::pair<uint32_t, EventItem>& item : items)
+    {
+      sources.push_back(std::vector<std::pair<FieldSource, std::size_t>>());
+      for (const std::string& field : item.second.Fields)
+      {
+        const std::vector<std::string>::const_iterator column = std::find(batch.Fields.begin(), batch.Fields.end(), field);
+        FieldSource source = FieldSource::None;
+        if (column != batch.Fields.end())
+        {
+          source = FieldSource::Column;
+        }
+        else if (field == "EventId")
+        {
+          source = FieldSource::EventID;
+        }
+        else if (field == "EventType")
+        {
+          source = FieldSource::EventType;
+        }
+        else if (field == "SourceNode")
+        {
+          source = FieldSource::SourceNode;
+        }
+        else if (field == "Time")
+        {
+          source = FieldSource::Time;
+        }
+        else if (field == "ReceiveTime")
+        {
+          source = FieldSource::ReceiveTime;
+        }
+        sources.back().push_back(std::make_pair(source, column - batch.Fields.begin()));
+      }
+    }
+
+    const uint64_t firstID = NextEventID.fetch_add(batch.Count);
+    const Variant now(CurrentDateTime());
+    const Variant eventType(batch.EventType);
+    const Variant sourceNode(batch.Source);
+    std::vector<std::pair<uint32_t, EventNotification>> notifications;
+    notifications.reserve(items.size() * batch.Count);
+    for (std::size_t event = 0; event < batch.Count; ++event)
+    {
+      const Variant eventID(MakeEventID(EventIDBase, firstID + event));
+      for (std::size_t i = 0; i < items.size(); ++i)
+      {
+        notifications.push_back(std::make_pair(items[i].second.SubscriptionID, EventNotification()));
+        EventNotification& notification = notifications.back().second;
+        notification.ItemID = items[i].first;
+        notification.Fields.resize(sources[i].size());
+        for (std::size_t field = 0; field < sources[i].size(); ++field)
+        {
+          Variant& value = notification.Fields[field];
+          switch (sources[i][field].first)
+          {
+            case FieldSource::Column: value = batch.Columns[sources[i][field].second][event]; break;
+            case FieldSource::EventID: value = eventID; break;
+            case FieldSource::EventType: value = eventType; break;
+            case FieldSource::SourceNode: value = sourceNode; break;
+            case FieldSource::Time: value = now; break;
+            case FieldSource::ReceiveTime: value = now; break;
+            case FieldSource::None: break;
+          }
+        }
+      }
+    }
+
+    std::unique_lock<std::mutex> lock(QueuesMutex);
+    for (std::pair<uint32_t, EventNotification>& notification : notifications)
+    {
+      std::map<uint32_t, Subscription>::iterator it = Subscriptions.find(notification.first);
+      if (it == Subscriptions.end())
+      {
+        continue;
+      }
+      ++Notifications;
+      std::deque<EventNotification>& queue = it->second.Events;
+      if (queue.size() >= it->second.MaxSize)
+      {
+        queue.pop_front();
+        ++Overflows;
+      }
+      queue.push_back(std::move(notification.second));
+    }
+  }
+
+  std::vector<EventNotification> SamplingEngine::PublishEvents(uint32_t subscriptionID, std::size_t maxCount)
+  {
+    std::unique_lock<std::mutex> lock(QueuesMutex);
+    std::map<uint32_t, Subscription>::iterator it = Subscriptions.find(subscriptionID);
+    if (it == Subscriptions.end())
+    {
+      throw std::logic_error("Unknown subscription.");
+    }
+    std::deque<EventNotification>& queue = it->second.Events;
+    const std::size_t count = maxCount ? std::min(maxCount, queue.size()) : queue.size();
+    std::vector<EventNotification> result(std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.begin() + count));
+    queue.erase(queue.begin(), queue.begin() + count);
+    return result;
+  }
+
+  SamplingStats SamplingEngine::GetStats() const
+  {
+    SamplingStats stats;
+    stats.Samples = Samples;
+    stats.Notifications = Notifications;
+    stats.Events = Events;
+    stats.Overflows = Overflows;
+    stats.LateTicks = LateTicks;
+    stats.ReadErrors = ReadErrors;
+    stats.CallbackErrors = CallbackErrors;
+    std::unique_lock<std::mutex> lock(ItemsMutex);
+    stats.Items = Locations.size() + EventItems.size();
+    stats.Bytes = GetMemoryUsage();
+    return stats;
+  }
+
+  std::size_t SamplingEngine::GetMemoryUsage() const
+  {
+    // Hash nodes are counted as the value plus two pointers.
+    std::size_t bytes = Locations.size() * (sizeof(std::pair<uint32_t, ItemLocation>) + 2 * sizeof(void*));
+    bytes += EventItems.size() * (sizeof(std::pair<uint32_t, EventItem>) + 3 * sizeof(void*));
+    for (const std::pair<const unsigned, Group>& group : Groups)
+    {
+      const Group& items = group.second;
+      bytes += sizeof(Group);
+      bytes += items.Items.capacity() * sizeof(uint32_t);
+      bytes += items.Subscriptions.capacity() * sizeof(uint32_t);
+      bytes += items.Nodes.capacity() * sizeof(NodeID);
+      bytes += items.Deadbands.capacity() * sizeof(DeadbandType);
+      bytes += items.Thresholds.capacity() * sizeof(double);
+      bytes += items.LastNumbers.capacity() * sizeof(double);
+      bytes += items.LastStatuses.capacity() * sizeof(uint32_t);
+      bytes += items.Sampled.capacity() / 8;
+      bytes += items.LastValues.size() * (sizeof(std::pair<uint32_t, Variant>) + 2 * sizeof(void*));
+      for (const NodeID& node : items.Nodes)
+      {
+        bytes += node.IsString() ? node.StringData.Identifier.capacity() : 0;
+      }
+    }
+    return bytes;
+  }
+
+  unsigned SamplingEngine::ToTicks(double milliseconds) const
+  {
+    const double ticks = std::ceil(milliseconds / TickMs);
+    return ticks < 1 ? 1 : static_cast<unsigned>(ticks);
+  }
+
+  void SamplingEngine::Run()
+  {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    const std::chrono::milliseconds tick(TickMs);
+    std::vector<uint32_t> expired;
+    std::vector<Snapshot> due;
+    std::vector<std::pair<uint32_t, MonitoredItemNotification>> notifications;
+
+    uint64_t now = 0;
+    while (!Stopping)
+    {
+      std::this_thread::sleep_until(start + tick * (now + 1));
+      const uint64_t current = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count() / TickMs;
+      LateTicks += current > now + 1 ? current - now - 1 : 0;
+      now = std::max(current, now + 1);
+
+      expired.clear();
+      due.clear();
+      {
+        std::unique_lock<std::mutex> lock(ItemsMutex);
+        Wheel.Advance(now, expired);
+        for (uint32_t interval : expired)
+        {
+          std::map<unsigned, Group>::iterator groupIt = Groups.find(interval);
+          if (groupIt->second.Items.empty())
+          {
+            Groups.erase(groupIt);
+            continue;
+          }
+          Snapshot snapshot;
+          snapshot.Interval = interval;
+          snapshot.Items = groupIt->second.Items;
+          snapshot.Nodes = groupIt->second.Nodes;
+          due.push_back(std::move(snapshot));
+          Wheel.Schedule(interval, now + interval);
+        }
+      }
+
+      // Reads run unlocked, so items can be added and removed meanwhile.
+      for (const Snapshot& snapshot : due)
+      {
+        std::vector<DataValue> values;
+        try
+        {
+          values = Sample(snapshot);
+        }
+        catch (const std::exception&)
+        {
+          ++ReadErrors;
+          continue;
+        }
+        std::unique_lock<std::mutex> lock(ItemsMutex);
+        Compare(snapshot, values, notifications);
+      }
+      Deliver(notifications);
+    }
+  }
+
+  std::vector<DataValue> SamplingEngine::Sample(const Snapshot& snapshot)
+  {
+    std::vector<DataValue> result;
+    result.reserve(snapshot.Nodes.size());
+    ReadParameters params;
+    params.TimestampsType = TimestampsToReturn::BOTH;
+    for (std::size_t begin = 0; begin < snapshot.Nodes.size(); begin += BatchSize)
+    {
+      const std::size_t end = std::min(begin + BatchSize, snapshot.Nodes.size());
+      params.AttributesToRead.resize(end - begin);
+      for (std::size_t i = begin; i < end; ++i)
+      {
+        params.AttributesToRead[i - begin].Node = snapshot.Nodes[i];
+        params.AttributesToRead[i - begin].Attribute = AttributeID::VALUE;
+      }
+      const std::vector<DataValue> values = Server->Attributes()->Read(params);
+      result.insert(result.end(), values.begin(), values.begin() + std::min(values.size(), end - begin));
+    }
+    Samples += result.size();
+    return result;
+  }
+
+  // Must be called under ItemsMutex. Items removed since the snapshot are skipped.
+  void SamplingEngine::Compare(const Snapshot& snapshot, const std::vector<DataValue>& values, std::vector<std::pair<uint32_t, MonitoredItemNotification>>& notifications)
+  {
+    std::map<unsigned, Group>::iterator groupIt = Groups.find(snapshot.Interval);
+    if (groupIt == Groups.end())
+    {
+      return;
+    }
+    Group& group = groupIt->second;
+    for (std::size_t i = 0; i < values.size(); ++i)
+    {
+      std::unordered_map<uint32_t, ItemLocation>::const_iterator location = Locations.find(snapshot.Items[i]);
+      if (location == Locations.end() || location->second.Interval != snapshot.Interval)
+      {
+        continue;
+      }
+      const std::size_t index = location->second.Index;
+      if (IsChanged(group, index, values[i]))
+      {
+        MonitoredItemNotification notification;
+        notification.ItemID = group.Items[index];
+        notification.Value = values[i];
+        notifications.push_back(std::make_pair(group.Subscriptions[index], notification));
+      }
+    }
+  }
+
+  // Values are compared with the last reported one, so slow drifts are reported once they exceed the deadband.
+  // A change of the status is always reported, as with the StatusValue trigger.
+  bool SamplingEngine::IsChanged(Group& group, std::size_t index, const DataValue& value)
+  {
+    const uint32_t status = value.Encoding & DATA_VALUE_STATUS_CODE ? static_cast<uint32_t>(value.Status) : 0;
+    double number = 0;
+    const bool numeric = ToDouble(value.Value, number);
+    const bool first = !group.Sampled[index];
+    bool changed = first || status != group.LastStatuses[index];
+    if (!changed && numeric)
+    {
+      const double delta = std::fabs(number - group.LastNumbers[index]);
+      changed = group.Deadbands[index] == DeadbandType::None ? delta != 0 : delta > group.Thresholds[index];
+    }
+    else if (!changed)
+    {
+      std::unordered_map<uint32_t, Variant>::const_iterator last = group.LastValues.find(group.Items[index]);
+      changed = last == group.LastValues.end() || !(value.Value == last->second);
+    }
+
+    if (changed)
+    {
+      group.Sampled[index] = true;
+      group.LastStatuses[index] = status;
+      if (numeric)
+      {
+        group.LastNumbers[index] = number;
+        group.LastValues.erase(group.Items[index]);
+      }
+      else
+      {
+        group.LastValues[group.Items[index]] = value.Value;
+      }
+    }
+    return changed;
+  }
+
+  void SamplingEngine::Deliver(std::vector<std::pair<uint32_t, MonitoredItemNotification>>& notifications)
+  {
+    if (notifications.empty())
+    {
+      return;
+    }
+    std::map<uint32_t, std::pair<NotificationCallback, std::vector<MonitoredItemNotification>>> callbacks;
+    {
+      std::unique_lock<std::mutex> lock(QueuesMutex);
+      for (std::pair<uint32_t, MonitoredItemNotification>& notification : notifications)
+      {
+        std::map<uint32_t, Subscription>::iterator it = Subscriptions.find(notification.first);
+        if (it == Subscriptions.end())
+        {
+          continue;
+        }
+        ++Notifications;
+        if (it->second.Callback)
+        {
+          std::pair<NotificationCallback, std::vector<MonitoredItemNotification>>& target = callbacks[notification.first];
+          target.first = it->second.Callback;
+          target.second.push_back(notification.second);
+          continue;
+        }
+        if (it->second.Queue.size() >= it->second.MaxSize)
+        {
+          it->second.Queue.pop_front();
+          ++Overflows;
+        }
+        it->second.Queue.push_back(notification.second);
+      }
+    }
+    QueuesCondition.notify_all();
+    notifications.clear();
+
+    // Callbacks run without the lock, so they may call back into the engine.
+    for (const std::pair<const uint32_t, std::pair<NotificationCallback, std::vector<MonitoredItemNotification>>>& callback : callbacks)
+    {
+      try
+      {
+        callback.second.first(callback.second.second);
+      }
+      catch (const std::exception&)
+      {
+        ++CallbackErrors;
+      }
+    }
+  }
+
+}
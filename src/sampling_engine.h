@@ -0,0 +1,222 @@
+/// @brief Sampling of monitored items driven by a timer wheel.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include "timer_wheel.h"
+
+#include <opc/ua/server.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace OpcUa
+{
+
+  enum class DeadbandType : uint32_t
+  {
+    None = 0,
+    Absolute = 1,
+    Percent = 2,
+  };
+
+  struct MonitoredItemParameters
+  {
+    NodeID Node;
+    uint32_t SubscriptionID;
+    double SamplingInterval; // Milliseconds.
+    DeadbandType Deadband;
+    double DeadbandValue;    // Absolute difference or percent of the range below.
+    double RangeLow;
+    double RangeHigh;
+
+    MonitoredItemParameters()
+      : SubscriptionID(0)
+      , SamplingInterval(0)
+      , Deadband(DeadbandType::None)
+      , DeadbandValue(0)
+      , RangeLow(0)
+      , RangeHigh(0)
+    {
+    }
+  };
+
+  struct MonitoredItemNotification
+  {
+    uint32_t ItemID;
+    DataValue Value;
+  };
+
+  // Events of one source and type, one column per field and one row per event.
+  struct EventBatch
+  {
+    NodeID Source;
+    NodeID EventType;
+    std::vector<std::string> Fields; // Browse names, e.g. "Message" or "Severity".
+    std::vector<std::vector<Variant>> Columns;
+    std::size_t Count;
+
+    EventBatch()
+      : Count(0)
+    {
+    }
+  };
+
+  struct EventNotification
+  {
+    uint32_t ItemID;
+    std::vector<Variant> Fields; // In the order the item selected them.
+  };
+
+  struct SamplingStats
+  {
+    uint64_t Samples;
+    uint64_t Notifications;
+    uint64_t Events;
+    uint64_t Overflows;
+    uint64_t LateTicks;
+    uint64_t ReadErrors;     // Sampling reads that failed, the group is sampled again next interval.
+    uint64_t CallbackErrors; // Notification callbacks that threw.
+    std::size_t Items;
+    std::size_t Bytes; // Memory held for the items.
+  };
+
+  // Local sampler: subscriptions live in this engine and are read with Publish.
+  // The subscription service of the server does not know about them, so the
+  // monitored items remote clients create are not served from here.
+  // Items with the same sampling interval form one group which is a single timer of the wheel.
+  // Group state is kept in parallel arrays and sampled with batched reads.
+  class SamplingEngine
+  {
+  public:
+    // Called on the sampling thread with the notifications of one tick.
+    typedef std::function<void (const std::vector<MonitoredItemNotification>&)> NotificationCallback;
+
+    SamplingEngine(Remote::Server::SharedPtr server, unsigned tickMs = 10, std::size_t batchSize = 1000);
+    ~SamplingEngine();
+
+    SamplingEngine(const SamplingEngine&) = delete;
+    SamplingEngine& operator=(const SamplingEngine&) = delete;
+
+    void Start();
+    void Stop();
+
+    uint32_t CreateSubscription(std::size_t queueSize);
+    // Notifications of this subscription go to the callback instead of the queue.
+    uint32_t CreateSubscription(NotificationCallback callback);
+    void DeleteSubscription(uint32_t subscriptionID);
+    uint32_t AddItem(const MonitoredItemParameters& params);
+    // Items on the Server object receive the events of every source.
+    uint32_t AddEventItem(uint32_t subscriptionID, const NodeID& notifier, const std::vector<std::string>& fields);
+    void RemoveItem(uint32_t itemID);
+
+    // EventId, EventType, SourceNode, Time and ReceiveTime are filled in when the batch has no column for them.
+    // The events only reach the event items of this engine, not the event notifiers of the server.
+    void FireEvents(const EventBatch& batch);
+
+    // Take up to maxCount queued notifications of the subscription, oldest first.
+    // Waits up to waitMs for the first one when the queue is empty.
+    std::vector<MonitoredItemNotification> Publish(uint32_t subscriptionID, std::size_t maxCount, unsigned waitMs = 0);
+    std::vector<EventNotification> PublishEvents(uint32_t subscriptionID, std::size_t maxCount);
+
+    SamplingStats GetStats() const;
+
+  private:
+    struct Group
+    {
+      unsigned Interval; // Ticks.
+      std::vector<uint32_t> Items;
+      std::vector<uint32_t> Subscriptions;
+      std::vector<NodeID> Nodes;
+      std::vector<DeadbandType> Deadbands;
+      std::vector<double> Thresholds;
+      std::vector<double> LastNumbers;
+      std::vector<uint32_t> LastStatuses;
+      std::vector<bool> Sampled;
+      // Only items with non numeric values have an entry, keyed by item.
+      std::unordered_map<uint32_t, Variant> LastValues;
+    };
+
+    struct ItemLocation
+    {
+      unsigned Interval;
+      std::size_t Index;
+    };
+
+    struct EventItem
+    {
+      uint32_t SubscriptionID;
+      NodeID Notifier;
+      std::vector<std::string> Fields;
+    };
+
+    struct Subscription
+    {
+      std::size_t MaxSize;
+      std::deque<MonitoredItemNotification> Queue;
+      std::deque<EventNotification> Events;
+      NotificationCallback Callback;
+    };
+
+    void Run();
+    // Items of a due group, copied so that the reads run without ItemsMutex.
+    struct Snapshot
+    {
+      unsigned Interval;
+      std::vector<uint32_t> Items;
+      std::vector<NodeID> Nodes;
+    };
+
+    std::vector<DataValue> Sample(const Snapshot& snapshot);
+    void Compare(const Snapshot& snapshot, const std::vector<DataValue>& values, std::vector<std::pair<uint32_t, MonitoredItemNotification>>& notifications);
+    bool IsChanged(Group& group, std::size_t index, const DataValue& value);
+    void Deliver(std::vector<std::pair<uint32_t, MonitoredItemNotification>>& notifications);
+    unsigned ToTicks(double milliseconds) const;
+    std::size_t GetMemoryUsage() const;
+
+  private:
+    const Remote::Server::SharedPtr Server;
+    const unsigned TickMs;
+    const std::size_t BatchSize;
+
+    mutable std::mutex ItemsMutex;
+    std::map<unsigned, Group> Groups;
+    std::unordered_map<uint32_t, ItemLocation> Locations;
+    std::map<uint32_t, EventItem> EventItems;
+    TimerWheel Wheel;
+    uint32_t NextItemID;
+
+    mutable std::mutex QueuesMutex;
+    std::condition_variable QueuesCondition;
+    std::map<uint32_t, Subscription> Subscriptions;
+    uint32_t NextSubscriptionID;
+
+    const uint64_t EventIDBase; // Random, so that ids differ between runs.
+    std::atomic<uint64_t> NextEventID;
+
+    std::atomic<bool> Stopping;
+    std::atomic<uint64_t> Samples;
+    std::atomic<uint64_t> Notifications;
+    std::atomic<uint64_t> Events;
+    std::atomic<uint64_t> Overflows;
+    std::atomic<uint64_t> LateTicks;
+    std::atomic<uint64_t> ReadErrors;
+    std::atomic<uint64_t> CallbackErrors;
+    std::thread Thread;
+  };
+
+}
@@ -0,0 +1,388 @@
+/// @brief Table of values in shared memory written by other processes.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "shared_value_table.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  const uint32_t TableMagic = 0x4F505654; // "OPVT"
+  const uint32_t TableVersion = 1;
+  // A writer that holds a slot longer than this many attempts is assumed dead.
+  const unsigned MaxReadAttempts = 1000;
+
+  template <typename T>
+  uint64_t ToBits(T value)
+  {
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(value));
+    return bits;
+  }
+
+  template <typename T>
+  T FromBits(uint64_t bits)
+  {
+    T value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  std::logic_error SystemError(const std::string& what, const std::string& name)
+  {
+    return std::logic_error(what + " '" + name + "': " + std::strerror(errno));
+  }
+}
+
+namespace OpcUa
+{
+
+  static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "Shared memory slots need lock free atomics.");
+
+  struct SharedValueTable::Header
+  {
+    std::atomic<uint32_t> Magic; // Set last by the creator.
+    uint32_t Version;
+    uint64_t SlotCount;
+    char Padding[48];
+  };
+
+  // One cache line per slot, so writers of neighbouring slots do not disturb each other.
+  struct SharedValueTable::Slot
+  {
+    std::atomic<uint32_t> Sequence; // Odd while a write is in progress.
+    std::atomic<uint32_t> Type;
+    std::atomic<uint64_t> Bits;
+    std::atomic<int64_t> Timestamp;
+    char Padding[40];
+  };
+
+  SharedValue SharedValue::FromBoolean(bool value, int64_t timestamp)
+  {
+    SharedValue result;
+    result.Type = SharedValueType::Boolean;
+    result.Bits = value ? 1 : 0;
+    result.Timestamp = timestamp;
+    return result;
+  }
+
+  SharedValue SharedValue::FromInt32(int32_t value, int64_t timestamp)
+  {
+    SharedValue result;
+    result.Type = SharedValueType::Int32;
+    result.Bits = ToBits(value);
+    result.Timestamp = timestamp;
+    return result;
+  }
+
+  SharedValue SharedValue::FromInt64(int64_t value, int64_t timestamp)
+  {
+    SharedValue result;
+    result.Type = SharedValueType::Int64;
+    result.Bits = ToBits(value);
+    result.Timestamp = timestamp;
+    return result;
+  }
+
+  SharedValue SharedValue::FromDouble(double value, int64_t timestamp)
+  {
+    SharedValue result;
+    result.Type = SharedValueType::Double;
+    result.Bits = ToBits(value);
+    result.Timestamp = timestamp;
+    return result;
+  }
+
+  Variant SharedValue::ToVariant() const
+  {
+    switch (Type)
+    {
+      case SharedValueType::Boolean: return Variant(Bits != 0);
+      case SharedValueType::Int32: return Variant(FromBits<int32_t>(Bits));
+      case SharedValueType::Int64: return Variant(FromBits<int64_t>(Bits));
+      case SharedValueType::Double: return Variant(FromBits<double>(Bits));
+      default: return Variant();
+    }
+  }
+
+  SharedValueTable::SharedValueTable(const std::string& name, std::size_t slotCount)
+    : Name(name)
+    , MappedSize(0)
+    , Mapping(nullptr)
+  {
+    static_assert(sizeof(Header) == 64 && sizeof(Slot) == 64, "Unexpected shared memory layout.");
+    const int fd = shm_open(name.c_str(), slotCount ? O_RDWR | O_CREAT : O_RDWR, 0600);
+    if (fd < 0)
+    {
+      throw SystemError("Cannot open shared value table", name);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+      close(fd);
+      throw SystemError("Cannot open shared value table", name);
+    }
+    bool created = false;
+    std::size_t size = info.st_size;
+    if (size == 0 && slotCount)
+    {
+      size = sizeof(Header) + slotCount * sizeof(Slot);
+      if (ftruncate(fd, size) != 0)
+      {
+        close(fd);
+        throw SystemError("Cannot resize shared value table", name);
+      }
+      created = true;
+    }
+    if (size < sizeof(Header))
+    {
+      close(fd);
+      throw std::logic_error("Shared value table '" + name + "' is not initialized.");
+    }
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+      throw SystemError("Cannot map shared value table", name);
+    }
+    MappedSize = size;
+    Mapping = static_cast<Header*>(memory);
+
+    // New pages are zero filled, so every slot starts with sequence 0.
+    if (created)
+    {
+      Mapping->Version = TableVersion;
+      Mapping->SlotCount = slotCount;
+      Mapping->Magic.store(TableMagic, std::memory_order_release);
+    }
+    const bool valid = Mapping->Magic.load(std::memory_order_acquire) == TableMagic
+      && Mapping->Version == TableVersion
+      && sizeof(Header) + Mapping->SlotCount * sizeof(Slot) <= MappedSize
+      && (!slotCount || Mapping->SlotCount == slotCount);
+    if (!valid)
+    {
+      munmap(Mapping, MappedSize);
+      throw std::logic_error("Shared value table '" + name + "' has a different layout.");
+    }
+  }
+
+  SharedValueTable::~SharedValueTable()
+  {
+    munmap(Mapping, MappedSize);
+  }
+
+  std::size_t SharedValueTable::GetSize() const
+  {
+    return Mapping->SlotCount;
+  }
+
+  SharedValueTable::Slot& SharedValueTable::GetSlot(std::size_t slot) const
+  {
+    if (slot >= Mapping->SlotCount)
+    {
+      throw std::logic_error("Slot index is out of range.");
+    }
+    Slot* slots = reinterpret_cast<Slot*>(Mapping + 1);
+    return slots[slot];
+  }
+
+  void SharedValueTable::Write(std::size_t index, const SharedValue& value)
+  {
+    Slot& slot = GetSlot(index);
+    // Writers of the same slot take turns; the odd sequence is the lock.
+    uint32_t sequence = slot.Sequence.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      if (sequence & 1)
+      {
+        std::this_thread::yield();
+        sequence = slot.Sequence.load(std::memory_order_relaxed);
+      }
+      else if (slot.Sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire, std::memory_order_relaxed))
+      {
+        break;
+      }
+    }
+    // Readers that see the new data also see the odd sequence.
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.Type.store(static_cast<uint32_t>(value.Type), std::memory_order_relaxed);
+    slot.Bits.store(value.Bits, std::memory_order_relaxed);
+    slot.Timestamp.store(value.Timestamp, std::memory_order_relaxed);
+    slot.Sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  bool SharedValueTable::Read(std::size_t index, SharedValue& value, uint32_t& sequence) const
+  {
+    const Slot& slot = GetSlot(index);
+    for (unsigned attempt = 0; attempt < MaxReadAttempts; ++attempt)
+    {
+      const uint32_t before = slot.Sequence.load(std::memory_order_acquire);
+      if (before & 1)
+      {
+        std::this_thread::yield();
+        continue;
+      }
+      value.Type = static_cast<SharedValueType>(slot.Type.load(std::memory_order_relaxed));
+      value.Bits = slot.Bits.load(std::memory_order_relaxed);
+      value.Timestamp = slot.Timestamp.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.Sequence.load(std::memory_order_relaxed) == before)
+      {
+        sequence = before;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void SharedValueTable::Unlink()
+  {
+    if (shm_unlink(Name.c_str()) != 0 && errno != ENOENT)
+    {
+      throw SystemError("Cannot remove shared value table", Name);
+    }
+  }
+
+  SharedTableFeeder::SharedTableFeeder(Remote::Server::SharedPtr server, std::shared_ptr<SharedValueTable> table, const std::vector<NodeID>& nodes, unsigned intervalMs)
+    : Server(server)
+    , Table(table)
+    , Nodes(nodes)
+    , Interval(intervalMs ? intervalMs : 1)
+    , Sequences(nodes.size(), 0)
+    , Stopping(false)
+    , Ticks(0)
+    , Updates(0)
+    , Failed(0)
+    , Busy(0)
+  {
+    if (Nodes.size() > Table->GetSize())
+    {
+      throw std::logic_error("Shared value table has fewer slots than nodes.");
+    }
+    Thread = std::thread([this](){ Run(); });
+  }
+
+  SharedTableFeeder::~SharedTableFeeder()
+  {
+    Stop();
+  }
+
+  void SharedTableFeeder::Stop()
+  {
+    {
+      std::unique_lock<std::mutex> lock(StopMutex);
+      Stopping = true;
+    }
+    StopCondition.notify_all();
+    if (Thread.joinable())
+    {
+      Thread.join();
+    }
+  }
+
+  void SharedTableFeeder::Sync()
+  {
+    std::unique_lock<std::mutex> lock(FeedMutex);
+    Feed();
+  }
+
+  SharedTableFeederStats SharedTableFeeder::GetStats() const
+  {
+    SharedTableFeederStats stats;
+    stats.Ticks = Ticks;
+    stats.Updates = Updates;
+    stats.Failed = Failed;
+    stats.Busy = Busy;
+    return stats;
+  }
+
+  void SharedTableFeeder::Run()
+  {
+    for (;;)
+    {
+      {
+        std::unique_lock<std::mutex> lock(StopMutex);
+        if (StopCondition.wait_for(lock, std::chrono::milliseconds(Interval), [this](){ return Stopping; }))
+        {
+          return;
+        }
+      }
+      Sync();
+    }
+  }
+
+  void SharedTableFeeder::Feed()
+  {
+    ++Ticks;
+    std::vector<WriteValue> values;
+    std::vector<std::pair<std::size_t, uint32_t>> written;
+    for (std::size_t i = 0; i < Nodes.size(); ++i)
+    {
+      SharedValue value;
+      uint32_t sequence = 0;
+      if (!Table->Read(i, value, sequence))
+      {
+        ++Busy;
+        continue;
+      }
+      if (sequence == Sequences[i] || value.Type == SharedValueType::None)
+      {
+        continue;
+      }
+      WriteValue write;
+      write.Node = Nodes[i];
+      write.Attribute = AttributeID::VALUE;
+      write.Data.Value = value.ToVariant();
+      write.Data.Encoding = DATA_VALUE;
+      if (value.Timestamp)
+      {
+        write.Data.SourceTimestamp.Value = value.Timestamp;
+        write.Data.Encoding |= DATA_VALUE_SOURCE_TIMESTAMP;
+      }
+      values.push_back(write);
+      written.push_back(std::make_pair(i, sequence));
+    }
+    if (values.empty())
+    {
+      return;
+    }
+
+    std::vector<StatusCode> statuses;
+    try
+    {
+      statuses = Server->Attributes()->Write(values);
+    }
+    catch (const std::exception&)
+    {
+      // Slots keep their old sequence and are tried again on the next tick.
+      Failed += values.size();
+      return;
+    }
+    for (std::size_t i = 0; i < written.size(); ++i)
+    {
+      if (i < statuses.size() && statuses[i] == StatusCode::Good)
+      {
+        ++Updates;
+      }
+      else
+      {
+        ++Failed;
+      }
+      // A rejected value is not retried until the producer writes a new one.
+      Sequences[written[i].first] = written[i].second;
+    }
+  }
+
+}
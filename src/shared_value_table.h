@@ -0,0 +1,135 @@
+/// @brief Table of values in shared memory written by other processes.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <opc/ua/server.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace OpcUa
+{
+
+  enum class SharedValueType : uint32_t
+  {
+    None = 0,
+    Boolean,
+    Int32,
+    Int64,
+    Double,
+  };
+
+  struct SharedValue
+  {
+    SharedValueType Type;
+    uint64_t Bits;     // The value, reinterpreted.
+    int64_t Timestamp; // Source timestamp, 0 when not set.
+
+    SharedValue()
+      : Type(SharedValueType::None)
+      , Bits(0)
+      , Timestamp(0)
+    {
+    }
+
+    static SharedValue FromBoolean(bool value, int64_t timestamp = 0);
+    static SharedValue FromInt32(int32_t value, int64_t timestamp = 0);
+    static SharedValue FromInt64(int64_t value, int64_t timestamp = 0);
+    static SharedValue FromDouble(double value, int64_t timestamp = 0);
+    Variant ToVariant() const;
+  };
+
+  // Fixed number of value slots in a POSIX shared memory segment.
+  // Writers never block readers: every slot is a seqlock, readers retry while a write is in progress.
+  class SharedValueTable
+  {
+  public:
+    // A slot count of 0 opens an existing segment, otherwise it is created when missing.
+    // Errors are thrown as std::logic_error.
+    SharedValueTable(const std::string& name, std::size_t slotCount);
+    ~SharedValueTable();
+
+    SharedValueTable(const SharedValueTable&) = delete;
+    SharedValueTable& operator=(const SharedValueTable&) = delete;
+
+    const std::string& GetName() const { return Name; }
+    std::size_t GetSize() const;
+
+    void Write(std::size_t slot, const SharedValue& value);
+    // Sequence is even and grows with every write, 0 means the slot was never written.
+    // Returns false when the slot stayed busy, e.g. its writer died in the middle of a write.
+    bool Read(std::size_t slot, SharedValue& value, uint32_t& sequence) const;
+    // Remove the segment name; mappings stay valid until they are closed.
+    void Unlink();
+
+  private:
+    struct Header;
+    struct Slot;
+
+    Slot& GetSlot(std::size_t slot) const;
+
+  private:
+    const std::string Name;
+    std::size_t MappedSize;
+    Header* Mapping;
+  };
+
+  struct SharedTableFeederStats
+  {
+    uint64_t Ticks;
+    uint64_t Updates;
+    uint64_t Failed;
+    uint64_t Busy;
+  };
+
+  // Copies changed slots into the address space every interval, all of them in one Write.
+  class SharedTableFeeder
+  {
+  public:
+    // Slot i feeds nodes[i].
+    SharedTableFeeder(Remote::Server::SharedPtr server, std::shared_ptr<SharedValueTable> table, const std::vector<NodeID>& nodes, unsigned intervalMs);
+    ~SharedTableFeeder();
+
+    SharedTableFeeder(const SharedTableFeeder&) = delete;
+    SharedTableFeeder& operator=(const SharedTableFeeder&) = delete;
+
+    void Stop();
+    // Copy the values written so far to the address space now instead of at the next tick.
+    void Sync();
+    SharedTableFeederStats GetStats() const;
+
+  private:
+    void Run();
+    void Feed();
+
+  private:
+    const Remote::Server::SharedPtr Server;
+    const std::shared_ptr<SharedValueTable> Table;
+    const std::vector<NodeID> Nodes;
+    const unsigned Interval;
+    std::vector<uint32_t> Sequences; // Last sequence written to the address space, per slot.
+    std::mutex FeedMutex;
+
+    std::mutex StopMutex;
+    std::condition_variable StopCondition;
+    bool Stopping;
+
+    std::atomic<uint64_t> Ticks;
+    std::atomic<uint64_t> Updates;
+    std::atomic<uint64_t> Failed;
+    std::atomic<uint64_t> Busy;
+    std::thread Thread;
+  };
+
+}
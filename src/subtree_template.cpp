@@ -0,0 +1,266 @@
+/// @brief Copies of an address space subtree.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "subtree_template.h"
+#include "node_id_text.h"
+
+#include <stdexcept>
+
+namespace
+{
+  std::string Substitute(const std::string& pattern, unsigned index)
+  {
+    const std::string number = std::to_string(index);
+    std::string result;
+    result.reserve(pattern.size() + 8);
+    std::size_t pos = 0;
+    for (std::size_t found = pattern.find("{}"); found != std::string::npos; found = pattern.find("{}", pos))
+    {
+      result.append(pattern, pos, found - pos);
+      result += number;
+      pos = found + 2;
+    }
+    result.append(pattern, pos, std::string::npos);
+    return result;
+  }
+
+  OpcUa::NodeID GetTypeDefinition(OpcUa::Remote::Server& server, const OpcUa::NodeID& id)
+  {
+    using namespace OpcUa;
+    BrowseDescription description;
+    description.NodeToBrowse = id;
+    description.Direction = BrowseDirection::Forward;
+    description.ReferenceTypeID = ReferenceID::HasTypeDefinition;
+    description.IncludeSubtypes = false;
+    description.NodeClasses = 0;
+    description.ResultMask = BrowseResultMask::ALL;
+
+    NodesQuery query;
+    query.MaxReferenciesPerNode = 1;
+    query.NodesToBrowse.push_back(description);
+    const std::vector<ReferenceDescription> references = server.Views()->Browse(query);
+    return references.empty() ? NodeID(ObjectID::FolderType) : references[0].TargetNodeID;
+  }
+}
+
+namespace OpcUa
+{
+
+  SubtreeTemplate::SubtreeTemplate(Remote::Server::SharedPtr server, const NodeID& root)
+    : Server(server)
+  {
+    TemplateNode node;
+    node.Parent = -1;
+    node.Class = NodeClass::Object;
+    node.IsProperty = false;
+    node.ReferenceType = ReferenceID::Organizes;
+    node.TypeDefinition = GetTypeDefinition(*Server, root);
+    Nodes.push_back(node);
+
+    std::vector<NodeID> ids(1, root);
+    std::set<NodeID> visited(ids.begin(), ids.end());
+    Browse(0, root, ids, visited);
+    ReadAttributes(ids);
+  }
+
+  std::size_t SubtreeTemplate::GetSize() const
+  {
+    return Nodes.size();
+  }
+
+  void SubtreeTemplate::Browse(std::size_t index, const NodeID& id, std::vector<NodeID>& ids, std::set<NodeID>& visited)
+  {
+    BrowseDescription description;
+    description.NodeToBrowse = id;
+    description.Direction = BrowseDirection::Forward;
+    description.ReferenceTypeID = ReferenceID::HierarchicalReferences;
+    description.IncludeSubtypes = true;
+    description.NodeClasses = 0;
+    description.ResultMask = BrowseResultMask::ALL;
+
+    NodesQuery query;
+    query.MaxReferenciesPerNode = 0;
+    query.NodesToBrowse.push_back(description);
+
+    for (const ReferenceDescription& reference : Server->Views()->Browse(query))
+    {
+      if (!visited.insert(reference.TargetNodeID).second)
+      {
+        continue;
+      }
+      if (reference.TargetNodeClass != NodeClass::Object && reference.TargetNodeClass != NodeClass::Variable)
+      {
+        throw std::logic_error("Only objects and variables can be instantiated: " + reference.BrowseName.Name);
+      }
+      TemplateNode node;
+      node.Parent = index;
+      node.Class = reference.TargetNodeClass;
+      node.IsProperty = reference.ReferenceTypeID == NodeID(ReferenceID::HasProperty);
+      node.ReferenceType = reference.ReferenceTypeID;
+      node.TypeDefinition = reference.TargetNodeTypeDefinition;
+      node.BrowseName = reference.BrowseName;
+      node.Path = Nodes[index].Path.empty() ? reference.BrowseName.Name : Nodes[index].Path + "." + reference.BrowseName.Name;
+      Nodes.push_back(node);
+      ids.push_back(reference.TargetNodeID);
+      Browse(Nodes.size() - 1, reference.TargetNodeID, ids, visited);
+    }
+  }
+
+  void SubtreeTemplate::ReadAttributes(const std::vector<NodeID>& ids)
+  {
+    const AttributeID attributes[] = {AttributeID::DISPLAY_NAME, AttributeID::DESCRIPTION, AttributeID::VALUE};
+    ReadParameters params;
+    params.TimestampsType = TimestampsToReturn::NEITHER;
+    for (const NodeID& id : ids)
+    {
+      for (AttributeID attribute : attributes)
+      {
+        AttributeValueID value;
+        value.Node = id;
+        value.Attribute = attribute;
+        params.AttributesToRead.push_back(value);
+      }
+    }
+
+    const std::vector<DataValue> values = Server->Attributes()->Read(params);
+    if (values.size() != params.AttributesToRead.size())
+    {
+      throw std::logic_error("Failed to read attributes of the template.");
+    }
+    for (std::size_t i = 0; i < Nodes.size(); ++i)
+    {
+      Nodes[i].DisplayName = values[i * 3].Value;
+      Nodes[i].Description = values[i * 3 + 1].Value;
+      Nodes[i].Value = values[i * 3 + 2].Value;
+    }
+  }
+
+  NodeID SubtreeTemplate::GetCopyID(const NodeID& root, std::size_t index) const
+  {
+    if (index == 0)
+    {
+      return root;
+    }
+    if (root.IsString())
+    {
+      return StringNodeID(root.GetStringIdentifier() + "." + Nodes[index].Path, root.GetNamespaceIndex());
+    }
+    if (root.IsInteger())
+    {
+      return NumericNodeID(root.GetIntegerIdentifier() + index, root.GetNamespaceIndex());
+    }
+    throw std::logic_error("NodeID pattern must be numeric or string.");
+  }
+
+  // AddFolder would give every object FolderType as type definition and Organizes as reference.
+  void SubtreeTemplate::AddObject(const NodeID& parent, const NodeID& id, const QualifiedName& name, const TemplateNode& node) const
+  {
+    AddNodesItem item;
+    item.ParentNodeId = parent;
+    item.ReferenceTypeId = node.ReferenceType;
+    item.RequestedNewNodeID = id;
+    item.BrowseName = name;
+    item.Class = NodeClass::Object;
+    item.TypeDefinition = node.TypeDefinition;
+    ObjectAttributes attributes;
+    attributes.DisplayName = LocalizedText(name.Name);
+    attributes.Description = LocalizedText(name.Name);
+    attributes.EventNotifier = 0;
+    attributes.WriteMask = 0;
+    attributes.UserWriteMask = 0;
+    item.Attributes = attributes;
+    const std::vector<AddNodesResult> results = Server->NodeManagement()->AddNodes(std::vector<AddNodesItem>(1, item));
+    if (results.empty() || results[0].Status != StatusCode::Good)
+    {
+      throw std::logic_error("Failed to add copy of template object: " + name.Name);
+    }
+  }
+
+  std::vector<Node> SubtreeTemplate::Instantiate(const Node& parent, unsigned count, const std::string& namePattern, const std::string& idPattern, unsigned first) const
+  {
+    const NodeIDParser parser;
+    std::vector<Node> roots;
+    roots.reserve(count);
+    std::vector<WriteValue> attributes;
+    attributes.reserve(count * Nodes.size() * 2);
+    std::vector<Node> copies;
+    copies.reserve(Nodes.size());
+
+    const NodeID firstRoot = parser.Parse(Substitute(idPattern, first));
+    for (unsigned number = first; number < first + count; ++number)
+    {
+      const NodeID root = firstRoot.IsInteger()
+        ? NumericNodeID(firstRoot.GetIntegerIdentifier() + (number - first) * Nodes.size(), firstRoot.GetNamespaceIndex())
+        : parser.Parse(Substitute(idPattern, number));
+      copies.clear();
+      for (std::size_t i = 0; i < Nodes.size(); ++i)
+      {
+        const TemplateNode& node = Nodes[i];
+        const NodeID id = GetCopyID(root, i);
+        if (i == 0)
+        {
+          const QualifiedName name(root.GetNamespaceIndex(), Substitute(namePattern, number));
+          AddObject(parent.GetId(), id, name, node);
+          copies.push_back(Node(Server, id));
+          roots.push_back(copies.back());
+        }
+        else if (node.Class == NodeClass::Object)
+        {
+          AddObject(copies[node.Parent].GetId(), id, node.BrowseName, node);
+          copies.push_back(Node(Server, id));
+        }
+        else if (node.IsProperty)
+        {
+          copies.push_back(copies[node.Parent].AddProperty(id, node.BrowseName, node.Value));
+        }
+        else
+        {
+          copies.push_back(copies[node.Parent].AddVariable(id, node.BrowseName, node.Value));
+        }
+
+        // The root keeps the display name made from its browse name.
+        if (i != 0 && !node.DisplayName.IsNul())
+        {
+          WriteValue value;
+          value.Node = id;
+          value.Attribute = AttributeID::DISPLAY_NAME;
+          value.Data.Value = node.DisplayName;
+          value.Data.Encoding = DATA_VALUE;
+          attributes.push_back(value);
+        }
+        if (!node.Description.IsNul())
+        {
+          WriteValue value;
+          value.Node = id;
+          value.Attribute = AttributeID::DESCRIPTION;
+          value.Data.Value = node.Description;
+          value.Data.Encoding = DATA_VALUE;
+          attributes.push_back(value);
+        }
+      }
+    }
+
+    if (!attributes.empty())
+    {
+      const std::vector<StatusCode> statuses = Server->Attributes()->Write(attributes);
+      if (statuses.size() != attributes.size())
+      {
+        throw std::logic_error("Failed to write attributes of the copies.");
+      }
+      for (std::size_t i = 0; i < statuses.size(); ++i)
+      {
+        if (statuses[i] != StatusCode::Good)
+        {
+          throw std::logic_error("Failed to write attributes of the copies: " + FormatNodeID(attributes[i].Node));
+        }
+      }
+    }
+    return roots;
+  }
+
+}
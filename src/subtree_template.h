@@ -0,0 +1,60 @@
+/// @brief Copies of an address space subtree.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <opc/ua/node.h>
+#include <opc/ua/server.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace OpcUa
+{
+
+  // Snapshot of an object with its hierarchical children, which can be added to the address space many times.
+  class SubtreeTemplate
+  {
+  public:
+    SubtreeTemplate(Remote::Server::SharedPtr server, const NodeID& root);
+
+    // "{}" in the patterns is replaced by the copy number, counted from first.
+    // idPattern is the NodeID text of the copy root. Children of a string root get "<root>.<browse path>".
+    // A numeric idPattern gives the root of the first copy; every copy takes a block of GetSize() numbers,
+    // its root first and the children in the order they were found.
+    std::vector<Node> Instantiate(const Node& parent, unsigned count, const std::string& namePattern, const std::string& idPattern, unsigned first = 0) const;
+
+    std::size_t GetSize() const;
+
+  private:
+    struct TemplateNode
+    {
+      int Parent;
+      NodeClass Class;
+      bool IsProperty;
+      NodeID ReferenceType;
+      NodeID TypeDefinition;
+      QualifiedName BrowseName;
+      std::string Path;
+      Variant Value;
+      Variant DisplayName;
+      Variant Description;
+    };
+
+    void Browse(std::size_t index, const NodeID& id, std::vector<NodeID>& ids, std::set<NodeID>& visited);
+    void ReadAttributes(const std::vector<NodeID>& ids);
+    NodeID GetCopyID(const NodeID& root, std::size_t index) const;
+    void AddObject(const NodeID& parent, const NodeID& id, const QualifiedName& name, const TemplateNode& node) const;
+
+  private:
+    const Remote::Server::SharedPtr Server;
+    std::vector<TemplateNode> Nodes; // Parents always go before their children.
+  };
+
+}
@@ -0,0 +1,83 @@
+/// @brief Hierarchical timer wheel.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "timer_wheel.h"
+
+#include <algorithm>
+
+namespace OpcUa
+{
+
+  TimerWheel::TimerWheel(uint64_t now)
+    : Now(now)
+    , Size(0)
+  {
+  }
+
+  void TimerWheel::Schedule(uint32_t id, uint64_t deadline)
+  {
+    Entry entry;
+    entry.ID = id;
+    entry.Deadline = std::max(deadline, Now + 1);
+    Insert(entry);
+    ++Size;
+  }
+
+  void TimerWheel::Insert(const Entry& entry)
+  {
+    const uint64_t maxDelta = (uint64_t(1) << (SlotBits * LevelCount)) - 1;
+    const uint64_t deadline = std::min(entry.Deadline, Now + maxDelta);
+    const uint64_t delta = deadline - Now;
+    unsigned level = 0;
+    while (level + 1 < LevelCount && delta >= (uint64_t(1) << (SlotBits * (level + 1))))
+    {
+      ++level;
+    }
+    const unsigned slot = (deadline >> (SlotBits * level)) & (SlotCount - 1);
+    Slots[level][slot].push_back(entry);
+  }
+
+  void TimerWheel::Cascade(unsigned level)
+  {
+    const unsigned slot = (Now >> (SlotBits * level)) & (SlotCount - 1);
+    if (slot == 0 && level + 1 < LevelCount)
+    {
+      Cascade(level + 1);
+    }
+    std::vector<Entry> entries;
+    entries.swap(Slots[level][slot]);
+    for (const Entry& entry : entries)
+    {
+      Insert(entry);
+    }
+  }
+
+  void TimerWheel::Advance(uint64_t now, std::vector<uint32_t>& expired)
+  {
+    while (Now < now)
+    {
+      ++Now;
+      const unsigned slot = Now & (SlotCount - 1);
+      if (slot == 0)
+      {
+        Cascade(1);
+      }
+
+      std::vector<Entry>& entries = Slots[0][slot];
+      std::vector<Entry>::iterator last = std::partition(entries.begin(), entries.end(),
+        [this](const Entry& entry) { return entry.Deadline > Now; });
+      for (std::vector<Entry>::iterator it = last; it != entries.end(); ++it)
+      {
+        expired.push_back(it->ID);
+      }
+      Size -= entries.end() - last;
+      entries.erase(last, entries.end());
+    }
+  }
+
+}
@@ -0,0 +1,52 @@
+/// @brief Hierarchical timer wheel.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace OpcUa
+{
+
+  // Timers are identified by the caller and expire in ticks. Each level has 64 slots,
+  // one slot of a level covers a whole turn of the level below. Far timers are moved
+  // down a level when their slot comes up, so adding and expiring a timer is O(1).
+  class TimerWheel
+  {
+  public:
+    explicit TimerWheel(uint64_t now = 0);
+
+    uint64_t GetNow() const { return Now; }
+    std::size_t GetSize() const { return Size; }
+
+    void Schedule(uint32_t id, uint64_t deadline);
+    // Move time forward up to 'now' and append timers expired on the way.
+    void Advance(uint64_t now, std::vector<uint32_t>& expired);
+
+  private:
+    struct Entry
+    {
+      uint32_t ID;
+      uint64_t Deadline;
+    };
+
+    static const unsigned SlotBits = 6;
+    static const unsigned SlotCount = 1 << SlotBits;
+    static const unsigned LevelCount = 4;
+
+    void Insert(const Entry& entry);
+    void Cascade(unsigned level);
+
+  private:
+    uint64_t Now;
+    std::size_t Size;
+    std::vector<Entry> Slots[LevelCount][SlotCount];
+  };
+
+}
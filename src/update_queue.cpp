@@ -0,0 +1,246 @@
+/// @brief Bounded lock free queue of value updates applied in batches.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "update_queue.h"
+
+#include <chrono>
+
+namespace
+{
+  std::size_t RoundUpToPowerOfTwo(std::size_t value)
+  {
+    std::size_t result = 2;
+    while (result < value)
+    {
+      result <<= 1;
+    }
+    return result;
+  }
+}
+
+namespace OpcUa
+{
+
+  UpdateQueue::UpdateQueue(Remote::Server::SharedPtr server, std::size_t capacity, UpdateQueuePolicy policy, std::size_t batchSize, unsigned intervalMs)
+    : Server(server)
+    , Mask(RoundUpToPowerOfTwo(capacity) - 1)
+    , Policy(policy)
+    , BatchSize(batchSize ? batchSize : 1)
+    , Interval(intervalMs ? intervalMs : 1)
+    , Cells(new Cell[Mask + 1])
+    , EnqueuePos(0)
+    , DequeuePos(0)
+    , Closed(false)
+    , Stopping(false)
+    , Pushed(0)
+    , Dropped(0)
+    , Applied(0)
+    , Failed(0)
+    , Batches(0)
+    , MaxDepth(0)
+  {
+    for (std::size_t i = 0; i <= Mask; ++i)
+    {
+      Cells[i].Sequence.store(i, std::memory_order_relaxed);
+    }
+    Thread = std::thread([this](){ Run(); });
+  }
+
+  UpdateQueue::~UpdateQueue()
+  {
+    Close();
+  }
+
+  bool UpdateQueue::Push(ValueUpdate&& update)
+  {
+    if (Closed.load(std::memory_order_acquire))
+    {
+      ++Dropped;
+      return false;
+    }
+    while (!TryPush(update))
+    {
+      if (Policy != UpdateQueuePolicy::DropOldest)
+      {
+        ++Dropped;
+        return false;
+      }
+      ValueUpdate oldest;
+      if (TryPop(oldest))
+      {
+        ++Dropped;
+      }
+      else
+      {
+        // Full and empty at once: another thread is between claiming and releasing a cell.
+        std::this_thread::yield();
+      }
+    }
+    ++Pushed;
+    const std::size_t depth = EnqueuePos.load(std::memory_order_relaxed) - DequeuePos.load(std::memory_order_relaxed);
+    std::size_t maxDepth = MaxDepth.load(std::memory_order_relaxed);
+    while (depth > maxDepth && depth <= Mask + 1 && !MaxDepth.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed))
+    {
+    }
+    return true;
+  }
+
+  bool UpdateQueue::TryPush(ValueUpdate& update)
+  {
+    std::size_t pos = EnqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      Cell& cell = Cells[pos & Mask];
+      const std::size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+      const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (difference == 0)
+      {
+        if (EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          cell.Update = std::move(update);
+          cell.Sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (difference < 0)
+      {
+        return false; // Full.
+      }
+      else
+      {
+        pos = EnqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool UpdateQueue::TryPop(ValueUpdate& update)
+  {
+    std::size_t pos = DequeuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      Cell& cell = Cells[pos & Mask];
+      const std::size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+      const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (difference == 0)
+      {
+        if (DequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        {
+          update = std::move(cell.Update);
+          cell.Sequence.store(pos + Mask + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (difference < 0)
+      {
+        return false; // Empty.
+      }
+      else
+      {
+        pos = DequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void UpdateQueue::Close()
+  {
+    Closed.store(true, std::memory_order_release);
+    {
+      std::unique_lock<std::mutex> lock(StopMutex);
+      Stopping = true;
+    }
+    StopCondition.notify_all();
+    if (Thread.joinable())
+    {
+      Thread.join();
+    }
+  }
+
+  UpdateQueueStats UpdateQueue::GetStats() const
+  {
+    UpdateQueueStats stats;
+    stats.Pushed = Pushed;
+    stats.Dropped = Dropped;
+    stats.Applied = Applied;
+    stats.Failed = Failed;
+    stats.Batches = Batches;
+    const std::size_t dequeued = DequeuePos.load(std::memory_order_relaxed);
+    const std::size_t enqueued = EnqueuePos.load(std::memory_order_relaxed);
+    stats.Depth = enqueued > dequeued ? enqueued - dequeued : 0;
+    stats.MaxDepth = MaxDepth;
+    stats.Capacity = Mask + 1;
+    return stats;
+  }
+
+  void UpdateQueue::Run()
+  {
+    for (;;)
+    {
+      // A full batch is sent at once, otherwise the queue is polled every interval.
+      if (Drain() == BatchSize)
+      {
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(StopMutex);
+      if (StopCondition.wait_for(lock, std::chrono::milliseconds(Interval), [this](){ return Stopping; }))
+      {
+        lock.unlock();
+        while (Drain() == BatchSize)
+        {
+        }
+        return;
+      }
+    }
+  }
+
+  std::size_t UpdateQueue::Drain()
+  {
+    std::vector<WriteValue> values;
+    ValueUpdate update;
+    while (values.size() < BatchSize && TryPop(update))
+    {
+      values.push_back(WriteValue());
+      WriteValue& value = values.back();
+      value.Node = std::move(update.Node);
+      value.Attribute = AttributeID::VALUE;
+      value.Data.Value = std::move(update.Value);
+      value.Data.Encoding = DATA_VALUE;
+      if (update.SourceTimestamp)
+      {
+        value.Data.SourceTimestamp.Value = update.SourceTimestamp;
+        value.Data.Encoding |= DATA_VALUE_SOURCE_TIMESTAMP;
+      }
+    }
+    if (values.empty())
+    {
+      return 0;
+    }
+
+    ++Batches;
+    try
+    {
+      const std::vector<StatusCode> statuses = Server->Attributes()->Write(values);
+      for (std::size_t i = 0; i < values.size(); ++i)
+      {
+        if (i < statuses.size() && statuses[i] == StatusCode::Good)
+        {
+          ++Applied;
+        }
+        else
+        {
+          ++Failed;
+        }
+      }
+    }
+    catch (const std::exception&)
+    {
+      Failed += values.size();
+    }
+    return values.size();
+  }
+
+}
@@ -0,0 +1,104 @@
+/// @brief Bounded lock free queue of value updates applied in batches.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <opc/ua/server.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OpcUa
+{
+
+  enum class UpdateQueuePolicy : uint32_t
+  {
+    DropNewest = 0, // A push to a full queue is rejected.
+    DropOldest = 1, // A push to a full queue replaces the oldest update.
+  };
+
+  struct ValueUpdate
+  {
+    NodeID Node;
+    Variant Value;
+    int64_t SourceTimestamp; // 0 when not set.
+  };
+
+  struct UpdateQueueStats
+  {
+    uint64_t Pushed;
+    uint64_t Dropped;
+    uint64_t Applied;
+    uint64_t Failed;
+    uint64_t Batches;
+    std::size_t Depth;
+    std::size_t MaxDepth;
+    std::size_t Capacity;
+  };
+
+  // Producers claim cells with one atomic increment and never wait for each other or for the
+  // drain thread. Cells carry a sequence number as in Dmitry Vyukov's bounded MPMC queue.
+  class UpdateQueue
+  {
+  public:
+    // Capacity is rounded up to a power of two.
+    UpdateQueue(Remote::Server::SharedPtr server, std::size_t capacity, UpdateQueuePolicy policy, std::size_t batchSize, unsigned intervalMs);
+    ~UpdateQueue();
+
+    UpdateQueue(const UpdateQueue&) = delete;
+    UpdateQueue& operator=(const UpdateQueue&) = delete;
+
+    // Returns false when the update was dropped.
+    bool Push(ValueUpdate&& update);
+    // Apply what is queued and stop the drain thread; later pushes are dropped.
+    void Close();
+    UpdateQueueStats GetStats() const;
+
+  private:
+    struct Cell
+    {
+      std::atomic<std::size_t> Sequence;
+      ValueUpdate Update;
+    };
+
+    bool TryPush(ValueUpdate& update);
+    bool TryPop(ValueUpdate& update);
+    void Run();
+    std::size_t Drain();
+
+  private:
+    const Remote::Server::SharedPtr Server;
+    const std::size_t Mask;
+    const UpdateQueuePolicy Policy;
+    const std::size_t BatchSize;
+    const unsigned Interval;
+    std::unique_ptr<Cell[]> Cells;
+
+    // Apart, so that producers and the drain thread do not share a cache line.
+    alignas(64) std::atomic<std::size_t> EnqueuePos;
+    alignas(64) std::atomic<std::size_t> DequeuePos;
+
+    alignas(64) std::atomic<bool> Closed;
+    std::mutex StopMutex;
+    std::condition_variable StopCondition;
+    bool Stopping;
+
+    std::atomic<uint64_t> Pushed;
+    std::atomic<uint64_t> Dropped;
+    std::atomic<uint64_t> Applied;
+    std::atomic<uint64_t> Failed;
+    std::atomic<uint64_t> Batches;
+    std::atomic<std::size_t> MaxDepth;
+    std::thread Thread;
+  };
+
+}
@@ -0,0 +1,65 @@
+/// @brief Access to numeric values stored in a Variant.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <opc/ua/protocol/types.h>
+
+#include <type_traits>
+#include <vector>
+
+namespace OpcUa
+{
+
+  struct VariantToDoubleConverter
+  {
+    double Result;
+    bool IsNumeric;
+
+    VariantToDoubleConverter()
+      : Result(0)
+      , IsNumeric(false)
+    {
+    }
+
+    template <typename T>
+    void Visit(const std::vector<T>& values)
+    {
+      Assign(values, std::is_arithmetic<T>());
+    }
+
+  private:
+    template <typename T>
+    void Assign(const std::vector<T>& values, std::true_type)
+    {
+      if (values.size() == 1)
+      {
+        Result = static_cast<double>(values[0]);
+        IsNumeric = true;
+      }
+    }
+
+    template <typename T>
+    void Assign(const std::vector<T>&, std::false_type)
+    {
+    }
+  };
+
+  inline bool ToDouble(const Variant& var, double& result)
+  {
+    if (var.IsNul())
+    {
+      return false;
+    }
+    VariantToDoubleConverter converter;
+    OpcUa::ApplyVisitor(var, converter);
+    result = converter.Result;
+    return converter.IsNumeric;
+  }
+
+}
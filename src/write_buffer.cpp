@@ -0,0 +1,204 @@
+/// @brief Coalescing buffer for asynchronous value writes.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "write_buffer.h"
+
+#include <chrono>
+
+namespace
+{
+  const std::size_t MaxQueuedErrors = 10000;
+}
+
+namespace OpcUa
+{
+
+  WriteBuffer::WriteBuffer(Remote::Server::SharedPtr server, unsigned intervalMs, std::size_t maxPending, ErrorCallback onError)
+    : Server(server)
+    , Interval(intervalMs ? intervalMs : 1)
+    , MaxPending(maxPending ? maxPending : 1)
+    , OnError(onError)
+    , Stopping(false)
+    , Queued(0)
+    , Coalesced(0)
+    , Written(0)
+    , Failed(0)
+    , Requests(0)
+    , CallbackErrors(0)
+  {
+    Thread = std::thread([this](){ Run(); });
+  }
+
+  WriteBuffer::~WriteBuffer()
+  {
+    Stop();
+  }
+
+  void WriteBuffer::Stop()
+  {
+    {
+      std::unique_lock<std::mutex> lock(PendingMutex);
+      Stopping = true;
+    }
+    PendingCondition.notify_all();
+    if (Thread.joinable())
+    {
+      Thread.join();
+    }
+  }
+
+  void WriteBuffer::Set(const NodeID& node, const Variant& value)
+  {
+    bool full = false;
+    {
+      std::unique_lock<std::mutex> lock(PendingMutex);
+      std::pair<std::map<NodeID, Variant>::iterator, bool> inserted = Pending.insert(std::make_pair(node, value));
+      if (!inserted.second)
+      {
+        inserted.first->second = value;
+        ++Coalesced;
+      }
+      full = Pending.size() >= MaxPending;
+    }
+    ++Queued;
+    if (full)
+    {
+      PendingCondition.notify_all();
+    }
+  }
+
+  void WriteBuffer::Flush()
+  {
+    Send();
+  }
+
+  std::vector<WriteError> WriteBuffer::TakeErrors()
+  {
+    std::unique_lock<std::mutex> lock(ErrorsMutex);
+    std::vector<WriteError> result(Errors.begin(), Errors.end());
+    Errors.clear();
+    return result;
+  }
+
+  WriteBufferStats WriteBuffer::GetStats() const
+  {
+    WriteBufferStats stats;
+    stats.Queued = Queued;
+    stats.Coalesced = Coalesced;
+    stats.Written = Written;
+    stats.Failed = Failed;
+    stats.Requests = Requests;
+    stats.CallbackErrors = CallbackErrors;
+    return stats;
+  }
+
+  void WriteBuffer::Run()
+  {
+    for (;;)
+    {
+      bool stopping = false;
+      {
+        std::unique_lock<std::mutex> lock(PendingMutex);
+        PendingCondition.wait_for(lock, std::chrono::milliseconds(Interval),
+          [this](){ return Stopping || Pending.size() >= MaxPending; });
+        stopping = Stopping;
+      }
+      // Whatever is pending at stop is still written.
+      Send();
+      if (stopping)
+      {
+        return;
+      }
+    }
+  }
+
+  void WriteBuffer::Send()
+  {
+    std::unique_lock<std::mutex> sendLock(SendMutex);
+    std::map<NodeID, Variant> batch;
+    {
+      std::unique_lock<std::mutex> lock(PendingMutex);
+      batch.swap(Pending);
+    }
+    if (batch.empty())
+    {
+      return;
+    }
+
+    std::vector<WriteValue> values;
+    values.reserve(batch.size());
+    for (const std::pair<const NodeID, Variant>& item : batch)
+    {
+      WriteValue value;
+      value.Node = item.first;
+      value.Attribute = AttributeID::VALUE;
+      value.Data.Value = item.second;
+      value.Data.Encoding = DATA_VALUE;
+      values.push_back(value);
+    }
+
+    std::vector<WriteError> errors;
+    ++Requests;
+    try
+    {
+      const std::vector<StatusCode> statuses = Server->Attributes()->Write(values);
+      for (std::size_t i = 0; i < values.size(); ++i)
+      {
+        const StatusCode status = i < statuses.size() ? statuses[i] : StatusCode::BadNotWritable;
+        if (status != StatusCode::Good)
+        {
+          WriteError error;
+          error.Node = values[i].Node;
+          error.Status = status;
+          errors.push_back(error);
+        }
+      }
+    }
+    catch (const std::exception& exc)
+    {
+      for (const WriteValue& value : values)
+      {
+        WriteError error;
+        error.Node = value.Node;
+        error.Status = StatusCode::BadNotWritable;
+        error.Message = exc.what();
+        errors.push_back(error);
+      }
+    }
+    Written += values.size() - errors.size();
+    Failed += errors.size();
+    ReportErrors(errors);
+  }
+
+  void WriteBuffer::ReportErrors(std::vector<WriteError>& errors)
+  {
+    if (errors.empty())
+    {
+      return;
+    }
+    if (OnError)
+    {
+      try
+      {
+        OnError(errors);
+        return;
+      }
+      catch (const std::exception&)
+      {
+        ++CallbackErrors;
+      }
+    }
+    std::unique_lock<std::mutex> lock(ErrorsMutex);
+    Errors.insert(Errors.end(), errors.begin(), errors.end());
+    while (Errors.size() > MaxQueuedErrors)
+    {
+      Errors.pop_front();
+    }
+  }
+
+}
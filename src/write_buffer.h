@@ -0,0 +1,96 @@
+/// @brief Coalescing buffer for asynchronous value writes.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include <opc/ua/server.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OpcUa
+{
+
+  struct WriteError
+  {
+    NodeID Node;
+    StatusCode Status;
+    std::string Message;
+  };
+
+  struct WriteBufferStats
+  {
+    uint64_t Queued;
+    uint64_t Coalesced; // Values replaced by a newer one before they were sent.
+    uint64_t Written;
+    uint64_t Failed;
+    uint64_t Requests;
+    uint64_t CallbackErrors; // Error callbacks that threw, their errors are queued instead.
+  };
+
+  // Keeps the last value of every node and sends all of them in one Write request
+  // every interval or as soon as maxPending nodes are waiting.
+  class WriteBuffer
+  {
+  public:
+    typedef std::function<void (const std::vector<WriteError>&)> ErrorCallback;
+
+    WriteBuffer(Remote::Server::SharedPtr server, unsigned intervalMs, std::size_t maxPending, ErrorCallback onError = ErrorCallback());
+    ~WriteBuffer();
+
+    WriteBuffer(const WriteBuffer&) = delete;
+    WriteBuffer& operator=(const WriteBuffer&) = delete;
+
+    void Set(const NodeID& node, const Variant& value);
+    // Write everything pending in the calling thread.
+    void Flush();
+    void Stop();
+
+    // Errors are queued only when there is no callback or the callback threw.
+    std::vector<WriteError> TakeErrors();
+    WriteBufferStats GetStats() const;
+
+  private:
+    void Run();
+    void Send();
+    void ReportErrors(std::vector<WriteError>& errors);
+
+  private:
+    const Remote::Server::SharedPtr Server;
+    const unsigned Interval;
+    const std::size_t MaxPending;
+    const ErrorCallback OnError;
+
+    std::mutex PendingMutex;
+    std::condition_variable PendingCondition;
+    std::map<NodeID, Variant> Pending;
+    bool Stopping;
+
+    // Keeps batches in order when Flush races with the background thread.
+    std::mutex SendMutex;
+
+    std::mutex ErrorsMutex;
+    std::deque<WriteError> Errors;
+
+    std::atomic<uint64_t> Queued;
+    std::atomic<uint64_t> Coalesced;
+    std::atomic<uint64_t> Written;
+    std::atomic<uint64_t> Failed;
+    std::atomic<uint64_t> Requests;
+    std::atomic<uint64_t> CallbackErrors;
+
+    std::thread Thread;
+  };
+
+}
@@ -0,0 +1,163 @@
+/// @brief Batched notifications about changes of server variables, found by polling.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#include "write_hook.h"
+
+#include <chrono>
+
+namespace OpcUa
+{
+
+  void WriteHook::Inbox::Receive(const std::vector<MonitoredItemNotification>& notifications)
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    const std::size_t count = Events.size();
+    for (const MonitoredItemNotification& notification : notifications)
+    {
+      std::map<uint32_t, Item>::iterator it = Items.find(notification.ItemID);
+      if (it == Items.end())
+      {
+        continue;
+      }
+      Item& item = it->second;
+      const Variant& value = notification.Value.Value;
+      // The first sample repeats the value read when the hook was added, unless the node was written since.
+      if (value == item.Last)
+      {
+        continue;
+      }
+      WriteEvent event;
+      event.Node = item.Node;
+      event.Value = value;
+      event.Previous = item.Last;
+      event.SourceTimestamp = notification.Value.Encoding & DATA_VALUE_SOURCE_TIMESTAMP ? notification.Value.SourceTimestamp.Value : 0;
+      Events.push_back(event);
+      item.Last = value;
+    }
+    if (Events.size() != count)
+    {
+      Condition.notify_all();
+    }
+  }
+
+  WriteHook::WriteHook(Remote::Server::SharedPtr server, SamplingEngine& sampling, const std::vector<NodeID>& nodes,
+      double samplingInterval, unsigned batchIntervalMs, Callback callback)
+    : Server(server)
+    , Sampling(sampling)
+    , BatchInterval(batchIntervalMs)
+    , OnWrite(callback)
+    , Events(std::make_shared<Inbox>())
+    , SubscriptionID(0)
+    , EventCount(0)
+    , BatchCount(0)
+    , CallbackErrors(0)
+  {
+    ReadParameters params;
+    for (const NodeID& node : nodes)
+    {
+      AttributeValueID attribute;
+      attribute.Node = node;
+      attribute.Attribute = AttributeID::VALUE;
+      params.AttributesToRead.push_back(attribute);
+    }
+    const std::vector<DataValue> initial = Server->Attributes()->Read(params);
+
+    Events->Stopping = false;
+    const std::shared_ptr<Inbox> inbox = Events;
+    SubscriptionID = Sampling.CreateSubscription([inbox](const std::vector<MonitoredItemNotification>& notifications)
+      {
+        inbox->Receive(notifications);
+      });
+
+    try
+    {
+      // Items are registered under the inbox lock, so their first sample cannot get ahead of them.
+      std::unique_lock<std::mutex> lock(Events->Mutex);
+      for (std::size_t i = 0; i < nodes.size(); ++i)
+      {
+        const NodeID& node = nodes[i];
+        if (Events->ItemIDs.count(node))
+        {
+          continue;
+        }
+        MonitoredItemParameters item;
+        item.Node = node;
+        item.SubscriptionID = SubscriptionID;
+        item.SamplingInterval = samplingInterval;
+        const uint32_t id = Sampling.AddItem(item);
+        Events->ItemIDs[node] = id;
+        Events->Items[id].Node = node;
+        if (i < initial.size())
+        {
+          Events->Items[id].Last = initial[i].Value;
+        }
+      }
+    }
+    catch (...)
+    {
+      Sampling.DeleteSubscription(SubscriptionID);
+      throw;
+    }
+    Thread = std::thread([this](){ Run(); });
+  }
+
+  WriteHook::~WriteHook()
+  {
+    Sampling.DeleteSubscription(SubscriptionID);
+    {
+      std::unique_lock<std::mutex> lock(Events->Mutex);
+      Events->Stopping = true;
+    }
+    Events->Condition.notify_all();
+    Thread.join();
+  }
+
+  WriteHookStats WriteHook::GetStats() const
+  {
+    WriteHookStats stats;
+    stats.Events = EventCount;
+    stats.Batches = BatchCount;
+    stats.CallbackErrors = CallbackErrors;
+    return stats;
+  }
+
+  void WriteHook::Run()
+  {
+    std::vector<WriteEvent> batch;
+    for (;;)
+    {
+      {
+        std::unique_lock<std::mutex> lock(Events->Mutex);
+        Events->Condition.wait(lock, [this](){ return Events->Stopping || !Events->Events.empty(); });
+        if (Events->Stopping)
+        {
+          return;
+        }
+        // Let writes arriving close together go out as one batch.
+        if (BatchInterval)
+        {
+          Events->Condition.wait_for(lock, std::chrono::milliseconds(BatchInterval), [this](){ return Events->Stopping; });
+        }
+        batch.swap(Events->Events);
+      }
+
+      EventCount += batch.size();
+      ++BatchCount;
+      try
+      {
+        OnWrite(batch);
+      }
+      catch (const std::exception&)
+      {
+        ++CallbackErrors;
+      }
+      batch.clear();
+    }
+  }
+
+}
@@ -0,0 +1,97 @@
+/// @brief Batched notifications about changes of server variables, found by polling.
+/// @license GNU GPL
+///
+/// Distributed under the GNU GPL License
+/// (See accompanying file LICENSE or copy at
+/// http://www.gnu.org/licenses/gpl.html)
+///
+
+#pragma once
+
+#include "sampling_engine.h"
+
+#include <opc/ua/server.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OpcUa
+{
+
+  struct WriteEvent
+  {
+    NodeID Node;
+    Variant Value;
+    Variant Previous;
+    int64_t SourceTimestamp;
+  };
+
+  struct WriteHookStats
+  {
+    uint64_t Events;
+    uint64_t Batches;
+    uint64_t CallbackErrors;
+  };
+
+  // Polled change notifier: watches nodes through the sampling engine and passes every value change
+  // to the callback, in batches from one dispatcher thread. The write itself has already been applied
+  // when it is seen, so the callback cannot veto it, and changes that are undone within one sampling
+  // interval are not seen at all.
+  class WriteHook
+  {
+  public:
+    typedef std::function<void (const std::vector<WriteEvent>&)> Callback;
+
+    // The current values of the nodes are read first, so every later change is reported.
+    WriteHook(Remote::Server::SharedPtr server, SamplingEngine& sampling, const std::vector<NodeID>& nodes,
+      double samplingInterval, unsigned batchIntervalMs, Callback callback);
+    ~WriteHook();
+
+    WriteHook(const WriteHook&) = delete;
+    WriteHook& operator=(const WriteHook&) = delete;
+
+    WriteHookStats GetStats() const;
+
+  private:
+    struct Item
+    {
+      NodeID Node;
+      Variant Last;
+    };
+
+    // Shared with the sampling callback, which may still run while the hook is destroyed.
+    struct Inbox
+    {
+      std::mutex Mutex;
+      std::condition_variable Condition;
+      std::map<uint32_t, Item> Items;
+      std::map<NodeID, uint32_t> ItemIDs;
+      std::vector<WriteEvent> Events;
+      bool Stopping;
+
+      void Receive(const std::vector<MonitoredItemNotification>& notifications);
+    };
+
+    void Run();
+
+  private:
+    const Remote::Server::SharedPtr Server;
+    SamplingEngine& Sampling;
+    const unsigned BatchInterval;
+    const Callback OnWrite;
+    const std::shared_ptr<Inbox> Events;
+    uint32_t SubscriptionID;
+
+    std::atomic<uint64_t> EventCount;
+    std::atomic<uint64_t> BatchCount;
+    std::atomic<uint64_t> CallbackErrors;
+    std::thread Thread;
+  };
+
+}
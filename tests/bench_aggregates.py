@@ -0,0 +1,53 @@
+#!/usr/bin/python
+# One minute averages over stored history: computed by the server with read_processed
+# against reading raw history and aggregating in Python.
+# Build the module with OPCUA_SCALAR_AGGREGATES=1 python setup.py build to time the portable kernel.
+import sys
+import time
+
+import opcua
+
+SAMPLES = 200000
+MINUTE = 60 * 1000 * 10000 # DateTime ticks
+ROUNDS = 10
+
+
+def measure(name, func):
+    start = time.time()
+    for _ in range(ROUNDS):
+        result = func()
+    elapsed = (time.time() - start) / ROUNDS
+    print("%-16s %8.2f ms %8d intervals" % (name, elapsed * 1000, len(result)))
+    return result
+
+
+def python_averages(var, start, end):
+    sums = {}
+    for ts, value, status in var.read_history(start, end):
+        if status == 0:
+            bucket = (ts - start) // MINUTE
+            total, count = sums.get(bucket, (0.0, 0))
+            sums[bucket] = (total + value, count + 1)
+    return [total / count for total, count in sums.values()]
+
+
+if __name__ == "__main__":
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else SAMPLES
+    server = opcua.Server()
+    server.load_cpp_addressspace(True)
+    server.set_endpoint("opc.tcp://localhost:4852")
+    server.start()
+    try:
+        server.enable_history("/tmp/opcua_bench_aggregates")
+        var = server.get_objects_node().add_variable("3:BenchAggregates", 0.0)
+        server.historize(var)
+        for i in range(count):
+            var.set_value(float(i % 1000))
+        server.flush_history()
+        raw = var.read_history(0, 2**62)
+        start, end = raw[0][0], raw[-1][0] + 1
+        print("%d samples, %s kernel" % (len(raw), opcua.aggregate_kernel()))
+        measure("python", lambda: python_averages(var, start, end))
+        measure("read_processed", lambda: var.read_processed(start, end, 60 * 1000, opcua.AggregateType.AVERAGE))
+    finally:
+        server.stop()
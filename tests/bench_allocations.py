@@ -0,0 +1,48 @@
+#!/usr/bin/python
+# Heap allocations per item of the bulk read and write calls.
+# Build the module with OPCUA_COUNT_ALLOCATIONS=1 python setup.py build to get the counts.
+import sys
+import time
+
+import opcua
+
+VARIABLES = 5000
+ROUNDS = 20
+
+
+def measure(name, func):
+    before = opcua.allocation_stats()
+    start = time.time()
+    for _ in range(ROUNDS):
+        func()
+    elapsed = (time.time() - start) / ROUNDS
+    after = opcua.allocation_stats()
+    allocations = float(after["allocations"] - before["allocations"]) / ROUNDS / VARIABLES
+    size = float(after["bytes"] - before["bytes"]) / ROUNDS / VARIABLES
+    print("%-24s %8.2f ms %8.1f allocations/item %8.1f bytes/item" % (name, elapsed * 1000, allocations, size))
+
+
+if __name__ == "__main__":
+    if opcua.allocation_stats() is None:
+        sys.stderr.write("module is built without OPCUA_COUNT_ALLOCATIONS\n")
+        sys.exit(1)
+    server = opcua.Server()
+    server.load_cpp_addressspace(True)
+    server.set_endpoint("opc.tcp://localhost:4849")
+    server.start()
+    client = opcua.Client()
+    client.set_endpoint("opc.tcp://localhost:4849")
+    try:
+        client.connect()
+        objects = client.get_objects_node()
+        nodes = [objects.add_variable("3:AllocVariable%d" % i, float(i)) for i in range(VARIABLES)]
+        ids = opcua.parse_node_ids([opcua.format_node_ids([node])[0] for node in nodes])
+        values = [float(i) for i in range(VARIABLES)]
+        measure("read_values(nodes)", lambda: client.read_values(nodes))
+        measure("read_values(ids)", lambda: client.read_values(ids))
+        measure("write_values", lambda: client.write_values(ids, values))
+        measure("read_attributes", lambda: client.read_attributes(ids, [opcua.AttributeID.VALUE]))
+        measure("server read_values", lambda: server.read_values(ids))
+    finally:
+        client.disconnect()
+        server.stop()
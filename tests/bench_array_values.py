@@ -0,0 +1,46 @@
+#!/usr/bin/python
+# Benchmark of writing and reading large numeric arrays through one variable.
+# Lists are converted element by element, buffers are copied into the request in one go.
+import array
+import sys
+import time
+
+import opcua
+
+SIZE = 1000000
+ROUNDS = 10
+
+
+def measure(name, func):
+    start = time.time()
+    for _ in range(ROUNDS):
+        func()
+    elapsed = (time.time() - start) / ROUNDS
+    print("%-28s %8.1f ms %8.1f MB/s" % (name, elapsed * 1000, SIZE * 8 / elapsed / 1e6))
+
+
+if __name__ == "__main__":
+    server = opcua.Server()
+    server.load_cpp_addressspace(True)
+    server.set_endpoint("opc.tcp://localhost:4848")
+    server.start()
+    client = opcua.Client()
+    client.set_endpoint("opc.tcp://localhost:4848")
+    try:
+        client.connect()
+        values = [float(i) for i in range(SIZE)]
+        var = client.get_objects_node().add_variable("3:BenchArray", values)
+        buf = array.array('d', values)
+        measure("set_value(list)", lambda: var.set_value(values))
+        measure("set_value(array.array)", lambda: var.set_value(buf))
+        measure("get_value()", lambda: var.get_value())
+        measure("get_value_array()", lambda: var.get_value_array())
+        try:
+            import numpy
+            data = numpy.arange(SIZE, dtype=numpy.float64)
+            measure("set_value(numpy)", lambda: var.set_value(data))
+        except ImportError:
+            sys.stderr.write("numpy is not installed, skipping numpy input\n")
+    finally:
+        client.disconnect()
+        server.stop()
@@ -0,0 +1,35 @@
+#!/usr/bin/python
+# Throughput of large ByteString values, e.g. camera images, through one variable.
+import time
+
+import opcua
+
+SIZES = [1 << 20, 2 << 20, 8 << 20]
+ROUNDS = 10
+
+
+def measure(name, size, func):
+    start = time.time()
+    for _ in range(ROUNDS):
+        func()
+    elapsed = (time.time() - start) / ROUNDS
+    print("%-10s %5d KB %8.2f ms %8.1f MB/s" % (name, size >> 10, elapsed * 1000, size / elapsed / 1e6))
+
+
+if __name__ == "__main__":
+    server = opcua.Server()
+    server.load_cpp_addressspace(True)
+    server.set_endpoint("opc.tcp://localhost:4850")
+    server.start()
+    client = opcua.Client()
+    client.set_endpoint("opc.tcp://localhost:4850")
+    try:
+        client.connect()
+        var = client.get_objects_node().add_variable("3:BenchImage", b"")
+        for size in SIZES:
+            image = bytes(bytearray(size))
+            measure("write", size, lambda: var.set_value(image))
+            measure("read", size, lambda: var.get_value())
+    finally:
+        client.disconnect()
+        server.stop()
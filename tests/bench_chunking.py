@@ -0,0 +1,82 @@
+#!/usr/bin/python
+# Benchmark of client request chunking on a loopback link with injected latency.
+# A local proxy delays every chunk by DELAY seconds in each direction.
+import socket
+import sys
+import threading
+import time
+
+import opcua
+
+SERVER_PORT = 4846
+PROXY_PORT = 4847
+DELAY = 0.025
+VARIABLES = 20000
+
+
+def pump(src, dst, delay):
+    try:
+        while True:
+            data = src.recv(65536)
+            if not data:
+                break
+            time.sleep(delay)
+            dst.sendall(data)
+    except socket.error:
+        pass
+    finally:
+        dst.close()
+
+
+def proxy(listener, delay):
+    while True:
+        client, _ = listener.accept()
+        server = socket.create_connection(("localhost", SERVER_PORT))
+        for src, dst in ((client, server), (server, client)):
+            t = threading.Thread(target=pump, args=(src, dst, delay))
+            t.daemon = True
+            t.start()
+
+
+def measure(clt, nodes, chunk):
+    clt.set_request_chunk_size(chunk)
+    start = time.time()
+    clt.read_values(nodes)
+    read = time.time() - start
+    start = time.time()
+    clt.write_values(nodes, [1.0] * len(nodes))
+    write = time.time() - start
+    return read, write
+
+
+if __name__ == "__main__":
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else VARIABLES
+    srv = opcua.Server()
+    srv.load_cpp_addressspace(True)
+    srv.set_endpoint("opc.tcp://localhost:%d" % SERVER_PORT)
+    srv.start()
+
+    listener = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    listener.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    listener.bind(("localhost", PROXY_PORT))
+    listener.listen(5)
+    t = threading.Thread(target=proxy, args=(listener, DELAY))
+    t.daemon = True
+    t.start()
+
+    try:
+        folder = srv.get_objects_node().add_folder("2:ChunkingBenchmark")
+        nodes = [folder.add_variable("2:Var%d" % i, 0.0).get_id() for i in range(count)]
+
+        clt = opcua.Client()
+        clt.set_endpoint("opc.tcp://localhost:%d" % PROXY_PORT)
+        clt.connect()
+        try:
+            print("RTT %d ms, %d values" % (DELAY * 2000, count))
+            for chunk in (0, 100, 500, 2000, 10000):
+                read, write = measure(clt, nodes, chunk)
+                print("chunk %5d: read %.2f s, write %.2f s, %s" % (chunk, read, write, clt.get_request_stats()))
+        finally:
+            clt.disconnect()
+    finally:
+        srv.stop()
@@ -0,0 +1,35 @@
+#!/usr/bin/python
+# Rate of events fired in batches to local event items, e.g. machine alarms.
+import array
+import time
+
+import opcua
+
+BATCHES = [1, 100, 2000]
+EVENTS = 100000
+
+
+def measure(server, source, batch):
+    severities = array.array('H', [500] * batch)
+    messages = ["Spindle overload"] * batch
+    start = time.time()
+    for _ in range(EVENTS // batch):
+        server.fire_local_events(source, opcua.ObjectID.BASE_EVENT_TYPE, {"Severity": severities, "Message": messages})
+    elapsed = time.time() - start
+    print("batch %5d %10.0f events/s" % (batch, EVENTS / elapsed))
+
+
+if __name__ == "__main__":
+    server = opcua.Server()
+    server.load_cpp_addressspace(True)
+    server.set_endpoint("opc.tcp://localhost:4851")
+    server.start()
+    try:
+        source = server.get_objects_node().add_folder("3:Machine")
+        subscription = server.create_local_subscription(EVENTS)
+        server.add_local_event_item(subscription, source, ["EventId", "Time", "Severity", "Message"])
+        for batch in BATCHES:
+            measure(server, source, batch)
+            server.publish_local_events(subscription, 0)
+    finally:
+        server.stop()
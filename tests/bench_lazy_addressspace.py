@@ -0,0 +1,38 @@
+#!/usr/bin/python
+# Startup time and memory of a small server with the standard address space loaded fully or lazily.
+import resource
+import subprocess
+import sys
+import time
+
+import opcua
+
+TAGS = 20
+
+
+def run(lazy):
+    before = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    start = time.time()
+    server = opcua.Server()
+    server.load_cpp_addressspace(True, lazy)
+    server.set_endpoint("opc.tcp://localhost:4852")
+    server.start()
+    try:
+        objects = server.get_objects_node()
+        for i in range(TAGS):
+            objects.add_variable("3:Tag%d" % i, float(i))
+        elapsed = time.time() - start
+        rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss - before
+        stats = server.memory_stats()
+        print("%-5s start %8.1f ms  rss +%7d kB  nodes %7d bytes" % ("lazy" if lazy else "full", elapsed * 1000, rss, stats["total_bytes"]))
+    finally:
+        server.stop()
+
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1:
+        run(sys.argv[1] == "lazy")
+    else:
+        # Separate processes, so that each mode starts from a fresh heap.
+        for mode in ["full", "lazy"]:
+            subprocess.check_call([sys.executable, __file__, mode])
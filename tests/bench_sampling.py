@@ -0,0 +1,50 @@
+#!/usr/bin/python
+# Stress benchmark of the server sampling engine: 100k monitored items
+# at mixed sampling intervals, values changing in the background.
+import sys
+import time
+
+import opcua
+
+ITEMS = 100000
+INTERVALS = [10, 50, 100, 250, 1000, 5000, 60000]
+DURATION = 10
+
+if __name__ == "__main__":
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else ITEMS
+    srv = opcua.Server()
+    srv.load_cpp_addressspace(True)
+    srv.set_endpoint("opc.tcp://localhost:4845")
+    srv.start()
+    try:
+        folder = srv.get_objects_node().add_folder("2:SamplingBenchmark")
+        start = time.time()
+        variables = [folder.add_variable("2:Var%d" % i, 0.0) for i in range(count)]
+        print("Created %d variables in %.2f s" % (count, time.time() - start))
+
+        sub = srv.create_local_subscription(count * 2)
+        start = time.time()
+        for i, v in enumerate(variables):
+            interval = INTERVALS[i % len(INTERVALS)]
+            if i % 2:
+                srv.add_local_monitored_item(sub, v, interval, opcua.DeadbandType.ABSOLUTE, 0.5)
+            else:
+                srv.add_local_monitored_item(sub, v, interval)
+        print("Added %d monitored items in %.2f s" % (count, time.time() - start))
+
+        received = 0
+        start = time.time()
+        step = 0
+        while time.time() - start < DURATION:
+            step += 1
+            for v in variables[step % 100::100]:
+                v.set_value(float(step))
+            received += len(srv.publish_local(sub, 0))
+            time.sleep(0.01)
+        elapsed = time.time() - start
+        stats = srv.get_sampling_stats()
+        print("Samples: %d (%.0f/s)" % (stats["samples"], stats["samples"] / elapsed))
+        print("Notifications: %d, received: %d, overflows: %d" % (stats["notifications"], received, stats["overflows"]))
+        print("Late ticks: %d" % stats["late_ticks"])
+    finally:
+        srv.stop()
@@ -0,0 +1,49 @@
+#!/usr/bin/python
+# Benchmark of in-process server read throughput with several Python threads reading at once,
+# for an increasing local read parallelism.
+import multiprocessing
+import sys
+import threading
+import time
+
+import opcua
+
+VARIABLES = 10000
+READERS = 8
+DURATION = 3
+
+
+def reader(srv, nodes, stop, counts, index):
+    while not stop.is_set():
+        srv.read_values(nodes)
+        counts[index] += len(nodes)
+
+
+if __name__ == "__main__":
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else VARIABLES
+    srv = opcua.Server()
+    srv.load_cpp_addressspace(True)
+    srv.set_endpoint("opc.tcp://localhost:4848")
+    srv.start()
+    try:
+        folder = srv.get_objects_node().add_folder("2:WorkerBenchmark")
+        nodes = opcua.parse_node_ids(["ns=2;i=%d" % (100000 + i) for i in range(count)])
+        for i in range(count):
+            folder.add_variable("ns=2;i=%d" % (100000 + i), "2:Var%d" % i, float(i))
+
+        threads = 1
+        while threads <= multiprocessing.cpu_count():
+            srv.set_local_read_parallelism(threads, 500)
+            stop = threading.Event()
+            counts = [0] * READERS
+            readers = [threading.Thread(target=reader, args=(srv, nodes, stop, counts, i)) for i in range(READERS)]
+            for t in readers:
+                t.start()
+            time.sleep(DURATION)
+            stop.set()
+            for t in readers:
+                t.join()
+            print("%2d worker threads: %.0f values/s" % (threads, sum(counts) / float(DURATION)))
+            threads *= 2
+    finally:
+        srv.stop()
@@ -4,6 +4,23 @@ from distutils.core import setup
 from distutils.extension import Extension
 
 sources = ['../src/module.cpp',
+           '../src/allocation_stats.cpp',
+           '../src/array_range.cpp',
+           '../src/history_aggregates.cpp',
+           '../src/history_log.cpp',
+           '../src/lazy_address_space.cpp',
+           '../src/memory_stats.cpp',
+           '../src/node_id_text.cpp',
+           '../src/node_registry.cpp',
+           '../src/reconnecting_server.cpp',
+           '../src/request_pipeline.cpp',
+           '../src/sampling_engine.cpp',
+           '../src/shared_value_table.cpp',
+           '../src/subtree_template.cpp',
+           '../src/timer_wheel.cpp',
+           '../src/update_queue.cpp',
+           '../src/write_buffer.cpp',
+           '../src/write_hook.cpp',
            'test_computer.cpp'
           ] 
 
@@ -20,6 +37,7 @@ libs = ['opccore',
         'opcuabinary',
         'stdc++',
         'pthread',
+        'rt',
         'boost_python']
 
 ldirs = [
@@ -1,6 +1,11 @@
 
+import array
+import os
 import unittest
 from multiprocessing import Process, Event
+import shutil
+import tempfile
+import threading
 import time
 
 
@@ -44,6 +49,135 @@ class AllTests(object):
         val = v.get_value()
         self.assertEqual(1, val) #This should be fixed!!! it should be [1]
 
+    def test_buffer_value(self):
+        o = self.opc.get_objects_node()
+        v = o.add_variable("3:VariableBufferValue", array.array('d', [1.5, 2.5, 3.5]))
+        self.assertEqual([1.5, 2.5, 3.5], v.get_value())
+        v.set_value(array.array('h', [4, -5]))
+        self.assertEqual([4, -5], list(v.get_value_array()))
+        v.set_value([7.5, 8.5])
+        self.assertEqual([7.5, 8.5], list(v.get_value_array()))
+        v.set_value(memoryview(array.array('d', [0.5, 1.5, 2.5]))[1:])
+        self.assertEqual([1.5, 2.5], v.get_value())
+
+    def test_index_range(self):
+        o = self.opc.get_objects_node()
+        v = o.add_variable("3:VariableIndexRange", [float(i) for i in range(10)])
+        self.assertEqual([2.0, 3.0, 4.0], v.get_value(index_range="2:4"))
+        self.assertEqual([8.0, 9.0], v.get_value(index_range="8:20"))
+        v.set_value([-1.0, -2.0], index_range="0:1")
+        self.assertEqual([-1.0, -2.0, 2.0, 3.0], v.get_value(index_range="0:3"))
+        v.set_value([-9.0], index_range="9")
+        self.assertEqual([-1.0, -2.0] + [float(i) for i in range(2, 9)] + [-9.0], v.get_value())
+        self.assertRaises(Exception, v.get_value, index_range="3:1")
+        short = o.add_variable("3:ShortIndexRange", [float(i) for i in range(5)])
+        self.assertEqual([1.0, 2.0, 3.0, 4.0], short.get_value(index_range="1:9"))
+        self.assertEqual([0.0, 1.0, 2.0, 3.0, 4.0], short.get_value(index_range="0:4"))
+        self.assertRaises(Exception, short.get_value, index_range="5:9")
+
+    def test_bytestring_value(self):
+        o = self.opc.get_objects_node()
+        data = bytes(bytearray(range(256))) * 1024
+        v = o.add_variable("3:VariableByteString", data)
+        self.assertEqual(data, v.get_value())
+        v.set_value(memoryview(data)[:10])
+        self.assertEqual(data[:10], v.get_value())
+        v.set_value(bytearray(b"abc"))
+        self.assertEqual(b"abc", v.get_value())
+
+    def test_read_values(self):
+        o = self.opc.get_objects_node()
+        a = o.add_variable("3:ReadValuesA", 1.5)
+        b = o.add_variable("3:ReadValuesB", 2.5)
+        result = self.opc.read_values([a, b.get_id()])
+        self.assertEqual([1.5, 2.5], list(result["value"]))
+        self.assertEqual([0, 0], list(result["status"]))
+        self.assertEqual(2, len(result["source_timestamp"]))
+
+    def test_translate_paths(self):
+        o = self.opc.get_objects_node()
+        f = o.add_folder("3:TranslateFolder")
+        v = f.add_variable("3:TranslateVariable", 1.0)
+        result = self.opc.translate_paths([["0:Objects", "3:TranslateFolder", "3:TranslateVariable"], "0:Objects/3:Missing", "0:Objects/3:TranslateFolder"])
+        self.assertEqual(3, len(result))
+        self.assertEqual((v, 0), result[0])
+        self.assertEqual(None, result[1][0])
+        self.assertNotEqual(0, result[1][1])
+        self.assertEqual(f, result[2][0])
+
+    def test_register_local_nodes(self):
+        o = self.opc.get_objects_node()
+        a = o.add_variable("3:RegisteredA", 1.0)
+        b = o.add_variable("3:RegisteredB", 2.0)
+        handles = self.opc.register_local_nodes([a, b.get_id()])
+        self.assertNotEqual(handles[0].get_local_alias(), handles[1].get_local_alias())
+        self.assertEqual(a.get_id(), handles[0].get_id())
+        self.assertEqual(2.0, handles[1].get_value())
+        handles[0].set_value(5.0)
+        self.assertEqual(5.0, a.get_value())
+        self.assertEqual([5.0, 2.0], list(self.opc.read_values(handles)["value"]))
+        self.opc.unregister_local_nodes(handles[:1])
+        self.assertRaises(Exception, handles[0].get_value)
+        reused = self.opc.register_local_nodes([b])
+        self.assertEqual(handles[0].get_local_alias() & 0xffffffff, reused[0].get_local_alias() & 0xffffffff)
+        self.assertRaises(Exception, handles[0].get_value)
+        self.assertEqual(2.0, reused[0].get_value())
+        self.assertRaises(Exception, self.opc.register_local_nodes, [opcua.NodeID(3, "NoSuchRegisteredNode")])
+
+    def test_get_attributes(self):
+        o = self.opc.get_objects_node()
+        v = o.add_variable("3:AttributesVariable", 2.5)
+        attrs = v.get_attributes([opcua.AttributeID.VALUE, opcua.AttributeID.BROWSE_NAME, opcua.AttributeID.EXECUTABLE])
+        self.assertEqual(2.5, attrs[opcua.AttributeID.VALUE])
+        self.assertEqual("AttributesVariable", attrs[opcua.AttributeID.BROWSE_NAME].name)
+        self.assertEqual(None, attrs[opcua.AttributeID.EXECUTABLE])
+        w = o.add_variable("3:AttributesVariable2", 3.5)
+        result = self.opc.read_attributes([v, w.get_id()], [opcua.AttributeID.VALUE, opcua.AttributeID.NODE_CLASS])
+        self.assertEqual([2.5, 3.5], result[opcua.AttributeID.VALUE])
+        self.assertEqual(2, len(result[opcua.AttributeID.NODE_CLASS]))
+
+    def test_get_children_described(self):
+        o = self.opc.get_objects_node()
+        f = o.add_folder("3:DescribedFolder")
+        v = f.add_variable("3:DescribedVariable", 1.0)
+        f.add_property("3:DescribedProperty", 2.0)
+        f.add_folder("3:DescribedSubfolder")
+        children = f.get_children_described()
+        self.assertEqual(3, len(children))
+        variables = f.get_children_described(opcua.ObjectID.HAS_COMPONENT, int(opcua.NodeClass.VARIABLE))
+        self.assertEqual(1, len(variables))
+        node, name, display_name, node_class, type_definition, reference_type = variables[0]
+        self.assertTrue(node is v)
+        self.assertEqual("DescribedVariable", name.name)
+        self.assertEqual(opcua.NodeClass.VARIABLE, node_class)
+        self.assertEqual("DescribedVariable", node.get_name().name)
+
+    def test_node_wrapper_cache(self):
+        o = self.opc.get_objects_node()
+        self.assertTrue(o is self.opc.get_objects_node())
+        v = o.add_variable("3:CachedWrapperVariable", 1)
+        self.assertTrue(v is o.get_child(["3:CachedWrapperVariable"]))
+        self.assertTrue(any(c is v for c in o.get_children()))
+
+    def test_parse_node_ids(self):
+        texts = ["i=85", "ns=2;s=Foo", "ns=1;g=09087E75-8E5E-499B-954F-F2A9603DB28A", "ns=3;b=AQID", "nsu=urn:test;i=7"]
+        ids = opcua.parse_node_ids(texts, ["http://opcfoundation.org/UA/", "urn:test"])
+        self.assertEqual(5, len(ids))
+        self.assertEqual(85, ids[0].get_identifier())
+        self.assertEqual("Foo", ids[1].get_identifier())
+        self.assertEqual(1, ids[-1].get_namespace_index())
+        self.assertEqual(texts[:4] + ["ns=1;i=7"], opcua.format_node_ids(ids))
+        self.assertEqual(["ns=2;s=Foo"], opcua.format_node_ids([opcua.NodeID(2, "Foo")]))
+        self.assertRaises(Exception, opcua.parse_node_ids, ["ns=2;x=Foo"])
+        result = self.opc.read_values(opcua.parse_node_ids(["i=85"]))
+        self.assertEqual([0], list(result["status"]))
+
+
+def write_shared_values(name):
+    table = opcua.SharedValueTable(name)
+    table.write(0, 2.5)
+    table.write(1, 7)
+
 
 class ServerProcess(Process):
 
@@ -89,6 +223,149 @@ class TestClient(unittest.TestCase, AllTests):
         print("Trying to stop server")
         self.srv.stop()
 
+    def test_write_behind(self):
+        o = self.opc.get_objects_node()
+        v = o.add_variable("3:WriteBehindVariable", 0.0)
+        self.clt.enable_write_behind(1000, 100000)
+        try:
+            for i in range(100):
+                v.set_value(float(i))
+            self.clt.flush()
+            stats = self.clt.get_write_stats()
+        finally:
+            self.clt.disable_write_behind()
+        self.assertEqual(99.0, v.get_value())
+        self.assertEqual(100, stats["queued"])
+        self.assertEqual(99, stats["coalesced"])
+        self.assertEqual(1, stats["written"])
+        self.assertEqual([], self.clt.get_write_errors())
+
+    def test_write_behind_raising_callback(self):
+        def on_error(errors):
+            raise RuntimeError("callback failed")
+        v = self.clt.get_node(opcua.NodeID(3, "NoSuchWriteBehindNode"))
+        self.clt.enable_write_behind(1000, 100000, on_error)
+        try:
+            v.set_value(1.0)
+            self.clt.flush()
+            stats = self.clt.get_write_stats()
+            errors = self.clt.get_write_errors()
+        finally:
+            self.clt.disable_write_behind()
+        self.assertEqual(1, stats["failed"])
+        self.assertEqual(1, stats["callback_errors"])
+        self.assertEqual(1, len(errors))
+
+    def test_request_chunking(self):
+        o = self.opc.get_objects_node()
+        nodes = [o.add_variable("3:ChunkedVariable%d" % i, 0.0) for i in range(5)]
+        self.clt.set_request_chunk_size(2)
+        try:
+            self.assertEqual(2, self.clt.get_request_chunk_size())
+            self.assertEqual([0] * 5, self.clt.write_values(nodes, [float(i) for i in range(5)]))
+            result = self.clt.read_values(nodes)
+            stats = self.clt.get_request_stats()
+        finally:
+            self.clt.set_request_chunk_size(0)
+        self.assertEqual([0.0, 1.0, 2.0, 3.0, 4.0], list(result["value"]))
+        self.assertEqual(2, stats["requests"])
+        self.assertEqual(6, stats["chunks"])
+        self.assertEqual(1, stats["max_in_flight"])
+        self.assertEqual(0, self.clt.get_request_chunk_size())
+
+    def test_reconnect(self):
+        o = self.clt.get_objects_node()
+        v = o.add_variable("3:ReconnectVariable", 1.0)
+        endpoints = self.clt.get_endpoints()
+        self.assertTrue(len(endpoints) > 0)
+        self.clt.enable_auto_reconnect(100, 10, 1000)
+        try:
+            self.assertTrue(self.clt.reconnect())
+            stats = self.clt.get_connection_stats()
+            self.assertEqual(endpoints, self.clt.get_endpoints())
+        finally:
+            self.clt.disable_auto_reconnect()
+        self.assertTrue(stats["connected"])
+        self.assertEqual(1, stats["reconnects"])
+        self.assertTrue(stats["last_reconnect_ms"] >= 0)
+        self.assertEqual(1.0, v.get_value())
+
+    def test_connect_twice(self):
+        clt = opcua.Client()
+        clt.set_endpoint("opc.tcp://localhost:4841")
+        clt.connect()
+        try:
+            clt.enable_write_behind(1000, 100000)
+            clt.set_request_chunk_size(2)
+            clt.connect()
+            self.assertRaises(Exception, clt.get_write_stats)
+            self.assertEqual(0, clt.get_request_chunk_size())
+            self.assertTrue(clt.get_objects_node().get_children())
+        finally:
+            clt.disconnect()
+
+class TestHistory(unittest.TestCase):
+    @classmethod
+    def setUpClass(self):
+        self.srv = opcua.Server()
+        self.srv.load_cpp_addressspace(True)
+        self.srv.set_endpoint("opc.tcp://localhost:4842")
+        self.history_dir = tempfile.mkdtemp()
+        self.srv.enable_history(self.history_dir)
+        self.srv.start()
+
+    @classmethod
+    def tearDownClass(self):
+        self.srv.stop()
+        shutil.rmtree(self.history_dir)
+
+    def test_history(self):
+        o = self.srv.get_objects_node()
+        v = o.add_variable("3:HistorizedVariable", 0.0)
+        self.srv.historize(v)
+        for i in range(10):
+            v.set_value(float(i))
+        self.srv.flush_history()
+        values = v.read_history(0, 2**62)
+        self.assertEqual([float(i) for i in range(10)], [val for ts, val, status in values])
+        self.assertEqual(3, len(v.read_history(0, 2**62, 3)))
+
+    def test_read_processed(self):
+        o = self.srv.get_objects_node()
+        v = o.add_variable("3:ProcessedVariable", 0.0)
+        self.srv.historize(v)
+        for i in range(10):
+            v.set_value(float(i))
+        self.srv.flush_history()
+        raw = v.read_history(0, 2**62)
+        start, end = raw[0][0], raw[-1][0] + 1
+        interval = (end - start) / 10000.0 + 1
+        def aggregate(kind):
+            return [(value, status) for ts, value, status in v.read_processed(start, end, interval, kind)]
+        self.assertEqual([(10, 0)], aggregate(opcua.AggregateType.COUNT))
+        self.assertEqual([(0.0, 0)], aggregate(opcua.AggregateType.MINIMUM))
+        self.assertEqual([(9.0, 0)], aggregate(opcua.AggregateType.MAXIMUM))
+        self.assertEqual([(4.5, 0)], aggregate(opcua.AggregateType.AVERAGE))
+        self.assertEqual([(0.0, 0)], aggregate(opcua.AggregateType.INTERPOLATIVE))
+        empty = v.read_processed(end, end + 100000, 5, opcua.AggregateType.AVERAGE)
+        self.assertEqual(2, len(empty))
+        self.assertTrue(all(status != 0 for ts, value, status in empty))
+        self.assertTrue(opcua.aggregate_kernel() in ("sse2", "scalar"))
+
+    def test_sampled_history(self):
+        o = self.srv.get_objects_node()
+        v = o.add_variable("3:SampledHistoryVariable", 1.0)
+        self.srv.historize(v, 10)
+        v.set_value(2.0)
+        deadline = time.time() + 5
+        values = []
+        while values[-1:] != [2.0] and time.time() < deadline:
+            self.srv.flush_history()
+            values = [val for ts, val, status in v.read_history(0, 2**62)]
+        self.assertEqual([2.0], values[-1:])
+        self.assertEqual(0, self.srv.get_history_stats()["failed"])
+
+
 class TestServer(unittest.TestCase, AllTests):
     @classmethod
     def setUpClass(self):
@@ -102,6 +379,184 @@ class TestServer(unittest.TestCase, AllTests):
     def tearDownClass(self):
         self.srv.stop()
 
+    def test_node_from_path_cache(self):
+        o = self.srv.get_objects_node()
+        self.assertTrue(o is self.srv.get_node_from_path(["Objects"]))
+
+    def test_monitored_items(self):
+        o = self.opc.get_objects_node()
+        v = o.add_variable("3:MonitoredVariable", 1.0)
+        sub = self.srv.create_local_subscription(100)
+        item = self.srv.add_local_monitored_item(sub, v, 10, opcua.DeadbandType.ABSOLUTE, 1.0)
+        notifications = self.srv.publish_local(sub, 0, 5000)
+        v.set_value(1.5) # inside deadband
+        v.set_value(3.0)
+        notifications += self.srv.publish_local(sub, 0, 5000)
+        self.assertEqual([1.0, 3.0], [value for handle, value, ts, status in notifications])
+        self.assertTrue(all(handle == item for handle, value, ts, status in notifications))
+        self.assertEqual(0, self.srv.get_sampling_stats()["read_errors"])
+        self.srv.delete_local_subscription(sub)
+
+    def test_write_hook(self):
+        o = self.opc.get_objects_node()
+        v = o.add_variable("3:HookedVariable", 1.0)
+        batches = []
+        hook = self.srv.add_write_hook([v], batches.append, 10, 10)
+        v.set_value(2.0)
+        deadline = time.time() + 5
+        while not batches and time.time() < deadline:
+            time.sleep(0.01)
+        self.srv.remove_write_hook(hook)
+        events = [event for batch in batches for event in batch]
+        self.assertEqual(1, len(events))
+        node, value, previous, ts = events[0]
+        self.assertTrue(node is v)
+        self.assertEqual((2.0, 1.0), (value, previous))
+
+    def test_write_hook_raising_callback(self):
+        o = self.opc.get_objects_node()
+        v = o.add_variable("3:HookedRaisingVariable", 1.0)
+        def on_write(batch):
+            raise RuntimeError("callback failed")
+        hook = self.srv.add_write_hook([v], on_write, 10, 10)
+        v.set_value(2.0)
+        deadline = time.time() + 5
+        while self.srv.get_write_hook_stats(hook)["callback_errors"] == 0 and time.time() < deadline:
+            time.sleep(0.01)
+        stats = self.srv.get_write_hook_stats(hook)
+        self.srv.remove_write_hook(hook)
+        self.assertEqual(1, stats["batches"])
+        self.assertEqual(1, stats["callback_errors"])
+
+    def test_shared_table(self):
+        o = self.opc.get_objects_node()
+        a = o.add_variable("3:SharedA", 0.0)
+        b = o.add_variable("3:SharedB", 0)
+        name = "/opcua_test_%d" % os.getpid()
+        table = opcua.SharedValueTable(name, 2)
+        try:
+            feeder = self.srv.add_shared_table(table, [a, b], 5)
+            producer = Process(target=write_shared_values, args=(name,))
+            producer.start()
+            producer.join()
+            self.srv.sync_shared_table(feeder)
+            stats = self.srv.get_shared_table_stats(feeder)
+            self.srv.remove_shared_table(feeder)
+        finally:
+            table.unlink()
+        self.assertEqual(2.5, table.read(0))
+        self.assertEqual(2.5, a.get_value())
+        self.assertEqual(7, b.get_value())
+        self.assertEqual(2, stats["updates"])
+
+    def test_fire_local_events(self):
+        o = self.opc.get_objects_node()
+        machine = o.add_folder("3:EventMachine")
+        other = o.add_folder("3:OtherMachine")
+        subscription = self.srv.create_local_subscription(100)
+        item = self.srv.add_local_event_item(subscription, machine, ["EventId", "SourceNode", "Severity", "Message"])
+        everything = self.srv.add_local_event_item(subscription, opcua.ObjectID.SERVER, ["Severity"])
+        self.srv.add_local_event_item(subscription, other, ["Severity"])
+        fired = self.srv.fire_local_events(machine, opcua.ObjectID.BASE_EVENT_TYPE, {"Severity": array.array('H', [100, 200, 300]), "Message": "Overheat"})
+        self.assertEqual(3, fired)
+        events = self.srv.publish_local_events(subscription, 0)
+        self.assertEqual(6, len(events))
+        mine = [fields for node, fields in events if node == item]
+        self.assertEqual([100, 200, 300], [fields[2] for fields in mine])
+        self.assertEqual(3, len(set(fields[0] for fields in mine)))
+        self.assertEqual(machine.get_id(), mine[0][1])
+        self.assertEqual([100, 200, 300], [fields[0] for node, fields in events if node == everything])
+        self.assertRaises(Exception, self.srv.fire_local_events, machine, opcua.ObjectID.BASE_EVENT_TYPE, {"Severity": [1, 2], "Message": ["a"]})
+        self.assertTrue(self.srv.get_sampling_stats()["events"] >= 3)
+        self.srv.delete_local_subscription(subscription)
+
+    def test_update_queue(self):
+        o = self.opc.get_objects_node()
+        nodes = [o.add_variable("3:Queued%d" % i, 0) for i in range(4)]
+        queue = self.srv.update_queue(1024, opcua.UpdateQueuePolicy.DROP_OLDEST, 100, 1)
+        def produce(node):
+            for i in range(1, 501):
+                queue.push(node, i)
+        producers = [threading.Thread(target=produce, args=(node,)) for node in nodes]
+        for producer in producers:
+            producer.start()
+        for producer in producers:
+            producer.join()
+        self.assertEqual(4, queue.push_many(nodes, [1000] * 4))
+        queue.close()
+        self.assertFalse(queue.push(nodes[0], 1))
+        stats = queue.get_stats()
+        self.assertEqual(2004, stats["pushed"])
+        self.assertEqual(2005, stats["applied"] + stats["dropped"])
+        self.assertEqual(0, stats["depth"])
+        self.assertEqual([1000] * 4, [node.get_value() for node in nodes])
+
+    def test_instantiate(self):
+        o = self.opc.get_objects_node()
+        cell = o.add_folder("ns=3;s=CellTemplate", "3:CellTemplate")
+        cell.add_variable("ns=3;s=CellTemplate.State", "3:State", 2)
+        cell.add_property("ns=3;s=CellTemplate.Size", "3:Size", 7.5)
+        plant = o.add_folder("3:Plant")
+        cells = self.srv.instantiate(cell, plant, 500, "Cell{}", "ns=3;s=Plant.Cell{}")
+        self.assertEqual(500, len(cells))
+        self.assertEqual(500, len(plant.get_children()))
+        self.assertEqual("Cell42", cells[42].get_name().name)
+        self.assertEqual(2, cells[42].get_child(["3:State"]).get_value())
+        self.assertEqual(7.5, self.srv.get_node(opcua.NodeID(3, "Plant.Cell499.Size")).get_value())
+        numbered = self.srv.instantiate(cell, plant, 3, "NumberedCell{}", "ns=3;i=7000")
+        self.assertEqual([opcua.NodeID(3, 7000), opcua.NodeID(3, 7003), opcua.NodeID(3, 7006)], [c.get_id() for c in numbered])
+        self.assertEqual(7.5, numbered[2].get_child(["3:Size"]).get_value())
+
+    def test_local_read_parallelism(self):
+        o = self.opc.get_objects_node()
+        nodes = [o.add_variable("3:WorkerVariable%d" % i, float(i)) for i in range(10)]
+        self.srv.set_local_read_parallelism(4, 3)
+        try:
+            self.assertEqual(4, self.srv.get_local_read_parallelism())
+            result = self.srv.read_values(nodes)
+            self.assertEqual([float(i) for i in range(10)], list(result["value"]))
+        finally:
+            self.srv.set_local_read_parallelism(1)
+
+    def test_lazy_address_space(self):
+        srv = opcua.Server()
+        srv.load_cpp_addressspace(True, lazy=True)
+        srv.set_endpoint("opc.tcp://localhost:4844")
+        srv.start()
+        try:
+            # The Server object is there from the start, only type children wait.
+            eager = srv.get_address_space_stats()["materialized"]
+            self.assertTrue(eager > 0)
+            v = srv.get_objects_node().add_variable("3:LazyVariable", 1.0)
+            self.assertEqual(1.0, v.get_value())
+            children = srv.get_objects_node().get_children_described()
+            server = [c for c in children if c[1].name == "Server"]
+            self.assertEqual(1, len(server))
+            self.assertEqual(opcua.NodeID(0, 2004), server[0][4])
+            status = srv.get_node(opcua.NodeID(0, 2259))
+            self.assertEqual(0, status.get_value())
+            result = srv.translate_paths(["0:Objects/0:Server/0:ServerCapabilities"])
+            self.assertEqual(0, result[0][1])
+            self.assertEqual(eager, srv.get_address_space_stats()["materialized"])
+            srv.get_node(opcua.NodeID(0, 2051))
+            stats = srv.get_address_space_stats()
+            self.assertEqual(eager + 1, stats["materialized"])
+            self.assertTrue(stats["materialized"] < stats["lazy"])
+        finally:
+            srv.stop()
+
+    def test_memory_stats(self):
+        before = self.srv.memory_stats()
+        o = self.opc.get_objects_node()
+        f = o.add_folder("3:MemoryStatsFolder")
+        for i in range(10):
+            f.add_variable("3:MemoryStatsVariable%d" % i, float(i))
+        after = self.srv.memory_stats()
+        variables = after["nodes"][opcua.NodeClass.VARIABLE]
+        self.assertEqual(10, variables["nodes"] - before["nodes"][opcua.NodeClass.VARIABLE]["nodes"])
+        self.assertTrue(variables["bytes_per_node"] > 0)
+        self.assertTrue(after["total_bytes"] > before["total_bytes"])
+
 
 
 